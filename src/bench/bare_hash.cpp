@@ -0,0 +1,61 @@
+// Copyright (c) 2021 The Xaya developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <amount.h>
+#include <bench/bench.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+
+#include <vector>
+
+namespace {
+
+/** Number of inputs of the transaction.  */
+constexpr size_t NUM_INPUTS = 500;
+/** Size of the scriptSig of each input (roughly that of P2PKH).  */
+constexpr size_t SCRIPTSIG_SIZE = 107;
+
+CMutableTransaction MakeLargeTx()
+{
+    FastRandomContext rng(true);
+
+    CMutableTransaction mtx;
+    for (size_t i = 0; i < NUM_INPUTS; ++i) {
+        mtx.vin.emplace_back(COutPoint(rng.rand256(), i % 4));
+        const std::vector<unsigned char> sig = rng.randbytes(SCRIPTSIG_SIZE);
+        mtx.vin.back().scriptSig = CScript(sig.begin(), sig.end());
+    }
+    mtx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+    mtx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+
+    return mtx;
+}
+
+} // namespace
+
+// Repeatedly query the bare hash of a large multi-input transaction,
+// as done for each move notification of the transaction.
+static void BareHashLargeTx(benchmark::Bench& bench)
+{
+    const CTransaction tx(MakeLargeTx());
+    bench.run([&] {
+        const uint256 hash = tx.GetBareHash();
+        ankerl::nanobench::doNotOptimizeAway(hash);
+    });
+}
+
+// Compute the bare hash once for a freshly constructed large transaction.
+static void BareHashLargeTxFirstCall(benchmark::Bench& bench)
+{
+    const CMutableTransaction mtx = MakeLargeTx();
+    bench.run([&] {
+        const CTransaction tx(mtx);
+        const uint256 hash = tx.GetBareHash();
+        ankerl::nanobench::doNotOptimizeAway(hash);
+    });
+}
+
+BENCHMARK(BareHashLargeTx);
+BENCHMARK(BareHashLargeTxFirstCall);
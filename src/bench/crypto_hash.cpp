@@ -5,6 +5,7 @@
 
 #include <bench/bench.h>
 #include <crypto/muhash.h>
+#include <crypto/neoscrypt.h>
 #include <crypto/ripemd160.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
@@ -90,6 +91,29 @@ static void SipHash_32b(benchmark::Bench& bench)
     });
 }
 
+/* Number of 80-byte headers to hash per Neoscrypt iteration */
+static const unsigned int NEOSCRYPT_HEADERS = 64;
+
+static void Neoscrypt(benchmark::Bench& bench)
+{
+    std::vector<uint8_t> in(80 * NEOSCRYPT_HEADERS, 0);
+    std::vector<uint8_t> out(32 * NEOSCRYPT_HEADERS);
+    bench.batch(NEOSCRYPT_HEADERS).unit("header").run([&] {
+        for (unsigned int i = 0; i < NEOSCRYPT_HEADERS; ++i) {
+            neoscrypt(in.data() + 80 * i, out.data() + 32 * i, 0);
+        }
+    });
+}
+
+static void NeoscryptMulti(benchmark::Bench& bench)
+{
+    std::vector<uint8_t> in(80 * NEOSCRYPT_HEADERS, 0);
+    std::vector<uint8_t> out(32 * NEOSCRYPT_HEADERS);
+    bench.batch(NEOSCRYPT_HEADERS).unit("header").run([&] {
+        neoscrypt_multi(in.data(), out.data(), 0, NEOSCRYPT_HEADERS);
+    });
+}
+
 static void FastRandom_32bit(benchmark::Bench& bench)
 {
     FastRandomContext rng(true);
@@ -163,6 +187,8 @@ BENCHMARK(SHA3_256_1M);
 BENCHMARK(SHA256_32b);
 BENCHMARK(SipHash_32b);
 BENCHMARK(SHA256D64_1024);
+BENCHMARK(Neoscrypt);
+BENCHMARK(NeoscryptMulti);
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
 
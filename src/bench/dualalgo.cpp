@@ -0,0 +1,62 @@
+// Copyright (c) 2021 The SpaceXpanse developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <chainparamsbase.h>
+#include <pow.h>
+#include <powdata.h>
+#include <util/system.h>
+
+#include <vector>
+
+namespace {
+
+/** Number of blocks in the chain before the benchmarked headers.  */
+constexpr size_t CHAIN_BLOCKS = 20000;
+/** Number of headers accepted on top of the chain per iteration.  */
+constexpr size_t NEW_HEADERS = 1000;
+/** Only Neoscrypt is mined above this height, leaving a long run of it.  */
+constexpr size_t LAST_SHA256D_HEIGHT = 1000;
+
+/**
+ * Attaches block i to the chain with the work done for it in
+ * AddToBlockIndex and ContextualCheckBlockHeader.
+ */
+void AttachBlock(std::vector<CBlockIndex>& blocks, const size_t i, const Consensus::Params& params)
+{
+    CBlockIndex& block = blocks[i];
+    block.nHeight = i;
+    block.pprev = (i == 0 ? nullptr : &blocks[i - 1]);
+    block.nTime = 1600000000 + i * AvgTargetSpacing(params, i);
+    block.algo = (i <= LAST_SHA256D_HEIGHT && i % 2 == 0 ? PowAlgo::SHA256D : PowAlgo::NEOSCRYPT);
+    block.BuildSkip();
+    block.nBits = GetNextWorkRequired(block.algo, block.pprev, params);
+    block.nChainWork = (block.pprev ? block.pprev->nChainWork : 0) + GetBlockProof(block);
+}
+
+} // namespace
+
+// Accept headers on a dual-algo chain that ends in a long run of Neoscrypt
+// blocks, so that the chain work correction has to look far back for the
+// last SHA-256d block.
+static void DualAlgoAcceptHeaders(benchmark::Bench& bench)
+{
+    ArgsManager args;
+    const auto chainParams = CreateChainParams(args, CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+
+    std::vector<CBlockIndex> blocks(CHAIN_BLOCKS + NEW_HEADERS);
+    for (size_t i = 0; i < CHAIN_BLOCKS; ++i) AttachBlock(blocks, i, params);
+
+    bench.batch(NEW_HEADERS).unit("header").run([&] {
+        for (size_t i = CHAIN_BLOCKS; i < blocks.size(); ++i) {
+            AttachBlock(blocks, i, params);
+            GetBlockProofEquivalentTime(blocks[i], *blocks[i].pprev, blocks[i], params);
+        }
+    });
+}
+
+BENCHMARK(DualAlgoAcceptHeaders);
@@ -0,0 +1,111 @@
+// Copyright (c) 2021 Daniel Kraft
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <names/common.h>
+#include <script/names.h>
+#include <script/script.h>
+#include <uint256.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** Number of names in the chainstate tip cache.  */
+constexpr size_t TIP_NAMES = 20000;
+/** Number of name updates in each simulated block.  */
+constexpr size_t BLOCK_NAMES = 1000;
+
+/** Name iterator that does not return anything.  */
+class EmptyNameIterator : public CNameIterator
+{
+public:
+    void seek(const valtype& start) override {}
+    bool next(valtype& name, CNameData& data) override { return false; }
+};
+
+/** Base view that has no names but supports iteration.  */
+class EmptyNameView : public CCoinsView
+{
+public:
+    CNameIterator* IterateNames() const override { return new EmptyNameIterator(); }
+};
+
+valtype MakeName(const size_t i)
+{
+    const std::string str = "p/player" + std::to_string(i);
+    return valtype(str.begin(), str.end());
+}
+
+CNameData MakeData(const valtype& name, const unsigned height)
+{
+    const std::string str = R"({"g":{"game":{"move":"some move data"}}})";
+    const CScript addr = CScript() << OP_TRUE;
+    const CNameScript op(CNameScript::buildNameUpdate(addr, name, valtype(str.begin(), str.end())));
+
+    CNameData data;
+    data.fromScript(height, COutPoint(uint256(), 0), op);
+    return data;
+}
+
+void FillTip(CCoinsViewCache& tip)
+{
+    for (size_t i = 0; i < TIP_NAMES; ++i) {
+        const valtype name = MakeName(i);
+        tip.SetName(name, MakeData(name, 1), false);
+    }
+}
+
+} // namespace
+
+// Connect blocks full of name updates to the chainstate tip, the way
+// ConnectBlock does with a temporary view that is flushed into the tip.
+static void NameCacheConnectBlock(benchmark::Bench& bench)
+{
+    EmptyNameView base;
+    CCoinsViewCache tip(&base);
+    FillTip(tip);
+
+    std::vector<std::pair<valtype, CNameData>> updates;
+    for (size_t i = 0; i < BLOCK_NAMES; ++i) {
+        const valtype name = MakeName(i * (TIP_NAMES / BLOCK_NAMES));
+        updates.emplace_back(name, MakeData(name, 2));
+    }
+
+    const uint256 block_hash = uint256S("01");
+    bench.batch(BLOCK_NAMES).unit("name").run([&] {
+        CCoinsViewCache view(&tip);
+        view.SetBestBlock(block_hash);
+        for (const auto& entry : updates) {
+            CNameData old;
+            view.GetName(entry.first, old);
+            view.SetName(entry.first, entry.second, false);
+        }
+        bool success = view.Flush();
+        assert(success);
+    });
+}
+
+// Iterate over all names in the tip cache in database order.
+static void NameCacheIterate(benchmark::Bench& bench)
+{
+    EmptyNameView base;
+    CCoinsViewCache tip(&base);
+    FillTip(tip);
+
+    bench.batch(TIP_NAMES).unit("name").run([&] {
+        std::unique_ptr<CNameIterator> iter(tip.IterateNames());
+        valtype name;
+        CNameData data;
+        size_t count = 0;
+        while (iter->next(name, data)) ++count;
+        assert(count == TIP_NAMES);
+    });
+}
+
+BENCHMARK(NameCacheConnectBlock);
+BENCHMARK(NameCacheIterate);
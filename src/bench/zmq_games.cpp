@@ -0,0 +1,118 @@
+// Copyright (c) 2021 Daniel Kraft
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <names/main.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <script/names.h>
+#include <script/script.h>
+#include <zmq/zmqgames.h>
+
+#include <univalue.h>
+
+#include <cassert>
+#include <string>
+
+namespace {
+
+/** Number of move transactions in the simulated block.  */
+constexpr size_t BLOCK_MOVES = 2000;
+
+CBlock MakeBlockWithMoves()
+{
+    CBlock block;
+    block.nTime = 1;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.emplace_back(COIN, CScript() << OP_TRUE);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+
+    const CScript addr = CScript() << OP_TRUE;
+    for (size_t i = 0; i < BLOCK_MOVES; ++i) {
+        const std::string nameStr = "p/player" + std::to_string(i);
+        const std::string valueStr = R"({"g":{"game":{"move":)" + std::to_string(i) + R"(,"data":[1,2,3]},"other":"x"}})";
+
+        CMutableTransaction tx;
+        tx.vin.emplace_back(COutPoint(uint256S("01"), i));
+        tx.vout.emplace_back(NAME_LOCKED_AMOUNT,
+                             CNameScript::buildNameUpdate(addr, valtype(nameStr.begin(), nameStr.end()),
+                                                          valtype(valueStr.begin(), valueStr.end())));
+        tx.vout.emplace_back(COIN, addr);
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+
+    return block;
+}
+
+} // namespace
+
+// Extract the moves and admin commands for all games from a block.
+static void ZmqGameBlockDataExtract(benchmark::Bench& bench)
+{
+    const CBlock block = MakeBlockWithMoves();
+    bench.batch(BLOCK_MOVES).unit("tx").run([&] {
+        const GameBlockData data(block);
+        assert(data.moves.size() == 2);
+    });
+}
+
+// Look up the data of a block that is already cached, as is done for
+// each notification after the first one for the same block.
+static void ZmqGameBlockDataCached(benchmark::Bench& bench)
+{
+    const CBlock block = MakeBlockWithMoves();
+    GameBlockDataCache cache;
+    cache.Get(block);
+    bench.run([&] {
+        const auto data = cache.Get(block);
+        assert(data->moves.size() == 2);
+    });
+}
+
+// Serialise the notification for a block with many moves of a game,
+// either as JSON or CBOR.
+static void ZmqGameBlockSerialize(benchmark::Bench& bench, const GameNotificationFormat format)
+{
+    const CBlock block = MakeBlockWithMoves();
+    const GameBlockData blockData(block);
+
+    UniValue blk(UniValue::VOBJ);
+    blk.pushKV("hash", block.GetHash().GetHex());
+    blk.pushKV("parent", block.hashPrevBlock.GetHex());
+    blk.pushKV("height", 1);
+    UniValue data(UniValue::VOBJ);
+    data.pushKV("block", blk);
+    data.pushKV("moves", blockData.moves.at("game"));
+    data.pushKV("admin", UniValue(UniValue::VARR));
+
+    bench.batch(BLOCK_MOVES).unit("move").run([&] {
+        std::string serialised;
+        switch (format) {
+        case GameNotificationFormat::JSON:
+            serialised = data.write();
+            break;
+        case GameNotificationFormat::CBOR:
+            serialised = EncodeGameBlockCbor(data);
+            break;
+        }
+        assert(!serialised.empty());
+    });
+}
+
+static void ZmqGameBlockSerializeJson(benchmark::Bench& bench)
+{
+    ZmqGameBlockSerialize(bench, GameNotificationFormat::JSON);
+}
+
+static void ZmqGameBlockSerializeCbor(benchmark::Bench& bench)
+{
+    ZmqGameBlockSerialize(bench, GameNotificationFormat::CBOR);
+}
+
+BENCHMARK(ZmqGameBlockDataExtract);
+BENCHMARK(ZmqGameBlockDataCached);
+BENCHMARK(ZmqGameBlockSerializeJson);
+BENCHMARK(ZmqGameBlockSerializeCbor);
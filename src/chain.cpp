@@ -125,17 +125,27 @@ CBlockIndex* CBlockIndex::GetAncestor(int height)
 const CBlockIndex*
 CBlockIndex::GetLastAncestorWithAlgo (const PowAlgo algo) const
 {
-  for (const CBlockIndex* pindex = this; pindex != nullptr;
-       pindex = pindex->pprev)
-    if (pindex->algo == algo)
-      return pindex;
-  return nullptr;
+  /* Each step skips the whole run of blocks with the current algo.  */
+  const CBlockIndex* pindex = this;
+  while (pindex != nullptr && pindex->algo != algo)
+    pindex = pindex->pskipOtherAlgo;
+  return pindex;
+}
+
+CBlockIndex*
+CBlockIndex::GetLastAncestorWithAlgo (const PowAlgo algo)
+{
+  return const_cast<CBlockIndex*> (
+      static_cast<const CBlockIndex*> (this)->GetLastAncestorWithAlgo (algo));
 }
 
 void CBlockIndex::BuildSkip()
 {
-    if (pprev)
+    if (pprev) {
         pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
+        pskipOtherAlgo = pprev->algo != algo ? pprev : pprev->pskipOtherAlgo;
+        pprevSameAlgo = pprev->GetLastAncestorWithAlgo(algo);
+    }
 }
 
 arith_uint256 GetBlockProof(const CBlockIndex& block)
@@ -148,6 +148,13 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip{nullptr};
 
+    //! pointer to the index of the last predecessor mined with the same PoW algo
+    CBlockIndex* pprevSameAlgo{nullptr};
+
+    //! pointer to the index of the last predecessor mined with a different PoW
+    //! algo, i.e. the block before the run of blocks with this block's algo
+    CBlockIndex* pskipOtherAlgo{nullptr};
+
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight{0};
 
@@ -314,7 +321,7 @@ public:
         return false;
     }
 
-    //! Build the skiplist pointer for this entry.
+    //! Build the skiplist and per-algo pointers for this entry.
     void BuildSkip();
 
     //! Efficiently find an ancestor of this block.
@@ -323,8 +330,10 @@ public:
 
     /**
      * Find the last previous block (including this one) mined by a particular
-     * PoW algo.  Returns nullptr if none exists.
+     * PoW algo.  Returns nullptr if none exists.  This follows the per-algo
+     * pointers built by BuildSkip, so it takes one step with two algos.
      */
+    CBlockIndex* GetLastAncestorWithAlgo(PowAlgo algo);
     const CBlockIndex* GetLastAncestorWithAlgo(PowAlgo algo) const;
 };
 
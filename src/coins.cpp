@@ -9,15 +9,20 @@
 #include <random.h>
 #include <version.h>
 
+#include <algorithm>
+#include <limits>
+
 bool CCoinsView::GetCoin(const COutPoint &outpoint, Coin &coin) const { return false; }
 uint256 CCoinsView::GetBestBlock() const { return uint256(); }
 std::vector<uint256> CCoinsView::GetHeadBlocks() const { return std::vector<uint256>(); }
 bool CCoinsView::GetName(const valtype &name, CNameData &data) const { return false; }
-bool CCoinsView::GetNameHistory(const valtype &name, CNameHistory &data) const { return false; }
+bool CCoinsView::GetNameHistoryRange(const valtype &name, const CNameHistory::Key& start, size_t maxCount, CNameHistory &data) const { data = CNameHistory(); return false; }
+bool CCoinsView::GetNameHistory(const valtype &name, CNameHistory &data) const { return GetNameHistoryRange(name, CNameHistory::Key(0, 0), std::numeric_limits<size_t>::max(), data); }
+bool CCoinsView::GetNamesInHeightRange(unsigned minHeight, unsigned maxHeight, CNameCache::NameSet& names) const { names.clear(); return false; }
 CNameIterator* CCoinsView::IterateNames() const { assert (false); }
 bool CCoinsView::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, const CNameCache &names) { return false; }
 std::unique_ptr<CCoinsViewCursor> CCoinsView::Cursor() const { return nullptr; }
-bool CCoinsView::ValidateNameDB(const CChainState& chainState, const std::function<void()>& interruption_point) const { return false; }
+bool CCoinsView::ValidateNameDB(const CChainState& chainState, bool incremental, const std::function<void()>& interruption_point) const { return false; }
 
 bool CCoinsView::HaveCoin(const COutPoint &outpoint) const
 {
@@ -31,18 +36,20 @@ bool CCoinsViewBacked::HaveCoin(const COutPoint &outpoint) const { return base->
 uint256 CCoinsViewBacked::GetBestBlock() const { return base->GetBestBlock(); }
 std::vector<uint256> CCoinsViewBacked::GetHeadBlocks() const { return base->GetHeadBlocks(); }
 bool CCoinsViewBacked::GetName(const valtype &name, CNameData &data) const { return base->GetName(name, data); }
-bool CCoinsViewBacked::GetNameHistory(const valtype &name, CNameHistory &data) const { return base->GetNameHistory(name, data); }
+bool CCoinsViewBacked::GetNameHistoryRange(const valtype &name, const CNameHistory::Key& start, size_t maxCount, CNameHistory &data) const { return base->GetNameHistoryRange(name, start, maxCount, data); }
+bool CCoinsViewBacked::GetNamesInHeightRange(unsigned minHeight, unsigned maxHeight, CNameCache::NameSet& names) const { return base->GetNamesInHeightRange(minHeight, maxHeight, names); }
 CNameIterator* CCoinsViewBacked::IterateNames() const { return base->IterateNames(); }
 void CCoinsViewBacked::SetBackend(CCoinsView &viewIn) { base = &viewIn; }
 bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, const CNameCache &names) { return base->BatchWrite(mapCoins, hashBlock, names); }
 std::unique_ptr<CCoinsViewCursor> CCoinsViewBacked::Cursor() const { return base->Cursor(); }
 size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
-bool CCoinsViewBacked::ValidateNameDB(const CChainState& chainState, const std::function<void()>& interruption_point) const { return base->ValidateNameDB(chainState, interruption_point); }
+bool CCoinsViewBacked::ValidateNameDB(const CChainState& chainState, bool incremental, const std::function<void()>& interruption_point) const { return base->ValidateNameDB(chainState, incremental, interruption_point); }
 
 CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
-    return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
+    return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage
+        + cacheNames.DynamicMemoryUsage();
 }
 
 CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const {
@@ -183,14 +190,27 @@ bool CCoinsViewCache::GetName(const valtype &name, CNameData& data) const {
     return base->GetName(name, data);
 }
 
-bool CCoinsViewCache::GetNameHistory(const valtype &name, CNameHistory& data) const {
-    if (cacheNames.getHistory(name, data))
-        return true;
+bool CCoinsViewCache::GetNameHistoryRange(const valtype &name, const CNameHistory::Key& start, size_t maxCount, CNameHistory& data) const {
+    /* Fetch enough entries from the base view so that the requested range
+       is complete even if some of them are removed or replaced by changes
+       in the cache.  Note that this does not attempt to cache backend
+       queries.  The cache only keeps track of changes!  */
+    const size_t overlap = cacheNames.getHistoryOverlap(name);
+    size_t baseCount = maxCount + overlap;
+    if (baseCount < maxCount)
+        baseCount = std::numeric_limits<size_t>::max();
 
-    /* Note: This does not attempt to cache backend queries.  The cache
-       only keeps track of changes!  */
+    base->GetNameHistoryRange(name, start, baseCount, data);
+    cacheNames.mergeHistory(name, start, maxCount, data);
 
-    return base->GetNameHistory(name, data);
+    return !data.empty();
+}
+
+bool CCoinsViewCache::GetNamesInHeightRange(unsigned minHeight, unsigned maxHeight, CNameCache::NameSet& names) const {
+    if (!base->GetNamesInHeightRange(minHeight, maxHeight, names))
+        return false;
+    cacheNames.mergeHeightIndex(minHeight, maxHeight, names);
+    return true;
 }
 
 CNameIterator* CCoinsViewCache::IterateNames() const {
@@ -206,31 +226,35 @@ void CCoinsViewCache::SetName(const valtype &name, const CNameData& data, bool u
     if (GetName(name, oldData))
     {
         /* Update the name history.  If we are undoing, we expect that
-           the top history item matches the data being set now.  If we
-           are not undoing, push the overwritten data onto the history stack.
-           Note that we only have to do this if the name already existed
-           in the database.  Otherwise, no special action is required
-           for the name history.  */
+           the data being set now is in the history, and remove it from
+           there.  If we are not undoing, add the overwritten data as new
+           history entry.  Note that we only have to do this if the name
+           already existed in the database.  Otherwise, no special action
+           is required for the name history.  */
         if (fNameHistory)
         {
+            /* The latest history entries are those at the height of the
+               entry being added or removed.  There is more than one only
+               if the name was updated multiple times in a block, so this
+               only reads a few entries to determine the history key.  */
+            const unsigned height = undo ? data.getHeight() : oldData.getHeight();
             CNameHistory history;
-            if (!GetNameHistory(name, history))
+            GetNameHistoryRange(name, CNameHistory::Key(height, 0), std::numeric_limits<size_t>::max(), history);
+            if (undo)
             {
-                /* Ensure that the history stack is indeed (still) empty
-                   and was not modified by the failing GetNameHistory call.  */
-                assert(history.empty());
+                assert(!history.empty() && history.getData().back() == data);
+                cacheNames.removeHistory(name, history.getKeys().back());
             }
-
-            if (undo)
-                history.pop(data);
             else
-                history.push(oldData);
-
-            cacheNames.setHistory(name, history);
+                cacheNames.addHistory(name, CNameHistory::Key(height, history.getData().size()), oldData);
         }
+        if (fNameHeightIndex)
+            cacheNames.setHeightIndex(oldData.getHeight(), name, false);
     } else
         assert (!undo);
 
+    if (fNameHeightIndex)
+        cacheNames.setHeightIndex(data.getHeight(), name, true);
     cacheNames.set(name, data);
 }
 
@@ -242,9 +266,11 @@ void CCoinsViewCache::DeleteName(const valtype &name) {
     {
         /* When deleting a name, the history should already be clean.  */
         CNameHistory history;
-        assert (!GetNameHistory(name, history) || history.empty());
+        assert (!GetNameHistoryRange(name, CNameHistory::Key(0, 0), 1, history));
     }
 
+    if (fNameHeightIndex)
+        cacheNames.setHeightIndex(oldData.getHeight(), name, false);
     cacheNames.remove(name);
 }
 
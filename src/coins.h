@@ -181,8 +181,16 @@ public:
     // Get a name (if it exists)
     virtual bool GetName(const valtype& name, CNameData& data) const;
 
-    // Get a name's history (if it exists)
-    virtual bool GetNameHistory(const valtype& name, CNameHistory& data) const;
+    // Get a range of a name's history entries:  At most maxCount entries
+    // with history key at least start.  Returns true iff any were found.
+    virtual bool GetNameHistoryRange(const valtype& name, const CNameHistory::Key& start, size_t maxCount, CNameHistory& data) const;
+
+    // Get a name's full history (if it exists)
+    bool GetNameHistory(const valtype& name, CNameHistory& data) const;
+
+    // Get all names last updated at a height in the given (inclusive) range.
+    // Requires -nameheightindex.
+    virtual bool GetNamesInHeightRange(unsigned minHeight, unsigned maxHeight, CNameCache::NameSet& names) const;
 
     // Get a name iterator.
     virtual CNameIterator* IterateNames() const;
@@ -194,8 +202,9 @@ public:
     //! Get a cursor to iterate over the whole state
     virtual std::unique_ptr<CCoinsViewCursor> Cursor() const;
 
-    // Validate the name database.
-    virtual bool ValidateNameDB(const CChainState& chainState, const std::function<void()>& interruption_point) const;
+    // Validate the name database.  If incremental is set, only the names
+    // changed since the last successful check are validated where possible.
+    virtual bool ValidateNameDB(const CChainState& chainState, bool incremental, const std::function<void()>& interruption_point) const;
 
     //! As we use CCoinsViews polymorphically, have a virtual destructor
     virtual ~CCoinsView() {}
@@ -218,13 +227,14 @@ public:
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
     bool GetName(const valtype& name, CNameData& data) const override;
-    bool GetNameHistory(const valtype& name, CNameHistory& data) const override;
+    bool GetNameHistoryRange(const valtype& name, const CNameHistory::Key& start, size_t maxCount, CNameHistory& data) const override;
+    bool GetNamesInHeightRange(unsigned minHeight, unsigned maxHeight, CNameCache::NameSet& names) const override;
     CNameIterator* IterateNames() const override;
     void SetBackend(CCoinsView &viewIn);
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, const CNameCache &names) override;
     std::unique_ptr<CCoinsViewCursor> Cursor() const override;
     size_t EstimateSize() const override;
-    bool ValidateNameDB(const CChainState& chainState, const std::function<void()>& interruption_point) const override;
+    bool ValidateNameDB(const CChainState& chainState, bool incremental, const std::function<void()>& interruption_point) const override;
 };
 
 
@@ -240,7 +250,6 @@ protected:
     mutable CCoinsMap cacheCoins;
 
     /* Cached dynamic memory usage for the inner Coin objects. */
-    /* TODO: Sum up also name cache usage.  */
     mutable size_t cachedCoinsUsage;
 
     /** Name changes cache.  */
@@ -260,7 +269,8 @@ public:
     uint256 GetBestBlock() const override;
     void SetBestBlock(const uint256 &hashBlock);
     bool GetName(const valtype &name, CNameData &data) const override;
-    bool GetNameHistory(const valtype &name, CNameHistory &data) const override;
+    bool GetNameHistoryRange(const valtype &name, const CNameHistory::Key& start, size_t maxCount, CNameHistory &data) const override;
+    bool GetNamesInHeightRange(unsigned minHeight, unsigned maxHeight, CNameCache::NameSet& names) const override;
     CNameIterator* IterateNames() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, const CNameCache &names) override;
     std::unique_ptr<CCoinsViewCursor> Cursor() const override {
@@ -328,9 +338,12 @@ public:
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
-    //! Calculate the size of the cache (in bytes)
+    //! Calculate the size of the cache (in bytes), including the name cache
     size_t DynamicMemoryUsage() const;
 
+    //! Calculate the size of the name cache alone (in bytes)
+    size_t NameCacheMemoryUsage() const { return cacheNames.DynamicMemoryUsage(); }
+
     //! Check whether all prevouts of the transaction are present in the UTXO set represented by this view
     bool HaveInputs(const CTransaction& tx) const;
 
@@ -2401,10 +2401,55 @@ void neoscrypt(const unsigned char *password, unsigned char *output, unsigned in
 
 
 #ifndef ASM
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+
+#include <cpuid.h>
+
+/* cpu_vec_exts()
+ * x86 detector of the vector extensions used by the multi-lane
+ * neoscrypt_multi() kernels; the bits match the assembly detector:
+ *   5 : SSE2
+ *  13 : AVX [CPU support and registers enabled by the OS]
+ *  16 : AVX2 [requires AVX]
+ * the other bits are not detected */
+unsigned int cpu_vec_exts() {
+    unsigned int eax, ebx, ecx, edx, xcr0, ret = 0;
+
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+      return(0);
+
+    /* SSE2 (bit 26 of %edx) */
+    if(edx & 0x04000000)
+      ret |= NEOSCRYPT_VEC_SSE2;
+
+    /* AVX (bit 28 of %ecx) and OSXSAVE (bit 27 of %ecx) */
+    if((ecx & 0x18000000) != 0x18000000)
+      return(ret);
+    __asm__("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0));
+    if((xcr0 & 6) != 6)
+      return(ret);
+    ret |= NEOSCRYPT_VEC_AVX;
+
+    /* AVX2 (bit 5 of %ebx of the CPUID standard function 7) */
+    if(__get_cpuid_max(0, 0) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if(ebx & 0x00000020)
+          ret |= NEOSCRYPT_VEC_AVX2;
+    }
+
+    return(ret);
+}
+
+#else
+
 unsigned int cpu_vec_exts() {
 
     /* No assembly, no extensions */
 
     return(0);
 }
+
+#endif
+
 #endif
\ No newline at end of file
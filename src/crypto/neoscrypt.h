@@ -9,6 +9,23 @@ extern "C" {
 void neoscrypt(const unsigned char *password, unsigned char *output,
   unsigned int profile);
 
+/* Hashes count 80-byte passwords stored back to back into count 32-byte
+ * outputs; profile 0 is processed with the multi-lane SSE2 or AVX2 kernels
+ * when cpu_vec_exts() reports them, everything else one by one */
+void neoscrypt_multi(const unsigned char *passwords, unsigned char *outputs,
+  unsigned int profile, unsigned int count);
+
+/* Like neoscrypt_multi(), but only uses the kernels selected by the given
+ * cpu_vec_exts() bits (which the CPU must support), e.g. for testing each
+ * kernel on its own */
+void neoscrypt_multi_exts(const unsigned char *passwords,
+  unsigned char *outputs, unsigned int profile, unsigned int count,
+  unsigned int exts);
+
+void neoscrypt_fastkdf(const unsigned char *password, unsigned int password_len,
+  const unsigned char *salt, unsigned int salt_len, unsigned int N,
+  unsigned char *output, unsigned int output_len);
+
 void neoscrypt_blake2s(const void *input, const unsigned int input_size,
   const void *key, const unsigned char key_size,
   void *output, const unsigned char output_size);
@@ -19,6 +36,11 @@ void neoscrypt_xor(void *dstp, const void *srcp, unsigned int len);
 
 unsigned int cpu_vec_exts(void);
 
+/* cpu_vec_exts() bits used to select the neoscrypt_multi() kernels */
+#define NEOSCRYPT_VEC_SSE2 0x00000020
+#define NEOSCRYPT_VEC_AVX  0x00002000
+#define NEOSCRYPT_VEC_AVX2 0x00010000
+
 #if (__cplusplus)
 }
 #else
@@ -0,0 +1,38 @@
+// Copyright (c) 2021 The SpaceXpanse developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/neoscrypt_lanes.h>
+
+namespace neoscrypt_avx2 {
+namespace {
+
+struct Ops {
+    using Vec = __m256i;
+    static constexpr unsigned int LANES = 8;
+    static constexpr unsigned int ALIGN = 32;
+
+    static inline Vec Add(Vec x, Vec y) { return _mm256_add_epi32(x, y); }
+    static inline Vec Xor(Vec x, Vec y) { return _mm256_xor_si256(x, y); }
+    static inline Vec Or(Vec x, Vec y) { return _mm256_or_si256(x, y); }
+    static inline Vec And(Vec x, Vec y) { return _mm256_and_si256(x, y); }
+    static inline Vec Rotl(Vec x, int n) { return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n)); }
+    static inline Vec Load(const uint32_t* p) { return _mm256_load_si256((const __m256i*)p); }
+    static inline void Store(uint32_t* p, Vec x) { _mm256_store_si256((__m256i*)p, x); }
+};
+
+} // namespace
+
+void Hash_8way(const unsigned char* input, unsigned char* output)
+{
+    neoscrypt_lanes::Hash<Ops>(input, output);
+}
+
+} // namespace neoscrypt_avx2
+
+#endif
@@ -0,0 +1,188 @@
+// Copyright (c) 2021 The SpaceXpanse developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_NEOSCRYPT_LANES_H
+#define BITCOIN_CRYPTO_NEOSCRYPT_LANES_H
+
+#include <crypto/neoscrypt.h>
+
+#include <stdint.h>
+
+#include <memory>
+#include <utility>
+
+/**
+ * Multi-lane implementation of Neoscrypt profile 0 (N = 128, r = 2, ChaCha20
+ * and Salsa20 with 20 rounds), shared between the SSE2 and AVX2 kernels.
+ *
+ * Ops provides the vector type Vec holding Ops::LANES 32-bit words and the
+ * operations on it.  Word i of every block vector holds word i of each of the
+ * independent hashes, so that all lanes are mixed in lock step.  FastKDF is
+ * cheap in comparison and runs for each lane on its own.
+ */
+namespace neoscrypt_lanes {
+
+static constexpr unsigned int N = 128;
+static constexpr unsigned int WORDS = 64;
+static constexpr unsigned int INPUT_SIZE = 80;
+static constexpr unsigned int OUTPUT_SIZE = 32;
+static constexpr unsigned int DOUBLE_ROUNDS = 10;
+
+template <typename Ops, typename Vec>
+inline void SalsaQuarter(Vec& a, Vec& b, Vec& c, Vec& d)
+{
+    b = Ops::Xor(b, Ops::Rotl(Ops::Add(a, d), 7));
+    c = Ops::Xor(c, Ops::Rotl(Ops::Add(b, a), 9));
+    d = Ops::Xor(d, Ops::Rotl(Ops::Add(c, b), 13));
+    a = Ops::Xor(a, Ops::Rotl(Ops::Add(d, c), 18));
+}
+
+template <typename Ops, typename Vec>
+inline void ChaChaQuarter(Vec& a, Vec& b, Vec& c, Vec& d)
+{
+    a = Ops::Add(a, b); d = Ops::Rotl(Ops::Xor(d, a), 16);
+    c = Ops::Add(c, d); b = Ops::Rotl(Ops::Xor(b, c), 12);
+    a = Ops::Add(a, b); d = Ops::Rotl(Ops::Xor(d, a), 8);
+    c = Ops::Add(c, d); b = Ops::Rotl(Ops::Xor(b, c), 7);
+}
+
+/** Salsa20 or ChaCha20 core on one 16-word block of each lane. */
+template <typename Ops, bool CHACHA>
+inline void Mix(typename Ops::Vec* B)
+{
+    typename Ops::Vec x[16];
+    for (int i = 0; i < 16; ++i) x[i] = B[i];
+
+    for (unsigned int r = 0; r < DOUBLE_ROUNDS; ++r) {
+        if (CHACHA) {
+            ChaChaQuarter<Ops>(x[0], x[4], x[8], x[12]);
+            ChaChaQuarter<Ops>(x[1], x[5], x[9], x[13]);
+            ChaChaQuarter<Ops>(x[2], x[6], x[10], x[14]);
+            ChaChaQuarter<Ops>(x[3], x[7], x[11], x[15]);
+            ChaChaQuarter<Ops>(x[0], x[5], x[10], x[15]);
+            ChaChaQuarter<Ops>(x[1], x[6], x[11], x[12]);
+            ChaChaQuarter<Ops>(x[2], x[7], x[8], x[13]);
+            ChaChaQuarter<Ops>(x[3], x[4], x[9], x[14]);
+        } else {
+            SalsaQuarter<Ops>(x[0], x[4], x[8], x[12]);
+            SalsaQuarter<Ops>(x[5], x[9], x[13], x[1]);
+            SalsaQuarter<Ops>(x[10], x[14], x[2], x[6]);
+            SalsaQuarter<Ops>(x[15], x[3], x[7], x[11]);
+            SalsaQuarter<Ops>(x[0], x[1], x[2], x[3]);
+            SalsaQuarter<Ops>(x[5], x[6], x[7], x[4]);
+            SalsaQuarter<Ops>(x[10], x[11], x[8], x[9]);
+            SalsaQuarter<Ops>(x[15], x[12], x[13], x[14]);
+        }
+    }
+
+    for (int i = 0; i < 16; ++i) B[i] = Ops::Add(B[i], x[i]);
+}
+
+template <typename Ops>
+inline void XorBlock(typename Ops::Vec* dst, const typename Ops::Vec* src)
+{
+    for (int i = 0; i < 16; ++i) dst[i] = Ops::Xor(dst[i], src[i]);
+}
+
+/** The Neoscrypt BlkMix for r = 2, see neoscrypt_blkmix. */
+template <typename Ops, bool CHACHA>
+inline void BlkMix(typename Ops::Vec* X)
+{
+    XorBlock<Ops>(&X[0], &X[48]);
+    Mix<Ops, CHACHA>(&X[0]);
+    XorBlock<Ops>(&X[16], &X[0]);
+    Mix<Ops, CHACHA>(&X[16]);
+    XorBlock<Ops>(&X[32], &X[16]);
+    Mix<Ops, CHACHA>(&X[32]);
+    XorBlock<Ops>(&X[48], &X[32]);
+    Mix<Ops, CHACHA>(&X[48]);
+    for (int i = 0; i < 16; ++i) std::swap(X[16 + i], X[32 + i]);
+}
+
+/**
+ * SMix of X using the scratchpad V.  The integerify step picks a different
+ * scratchpad entry for each lane, so the entries are gathered by masking
+ * with masks[l], which has all bits of lane l set.
+ */
+template <typename Ops, bool CHACHA>
+void SMix(typename Ops::Vec* X, typename Ops::Vec* V, const typename Ops::Vec* masks)
+{
+    using Vec = typename Ops::Vec;
+
+    for (unsigned int i = 0; i < N; ++i) {
+        for (unsigned int w = 0; w < WORDS; ++w) V[i * WORDS + w] = X[w];
+        BlkMix<Ops, CHACHA>(X);
+    }
+
+    alignas(Ops::ALIGN) uint32_t idx[Ops::LANES];
+    for (unsigned int i = 0; i < N; ++i) {
+        Ops::Store(idx, X[48]);
+        const Vec* entries[Ops::LANES];
+        for (unsigned int l = 0; l < Ops::LANES; ++l) {
+            entries[l] = &V[(idx[l] & (N - 1)) * WORDS];
+        }
+        for (unsigned int w = 0; w < WORDS; ++w) {
+            Vec v = Ops::And(entries[0][w], masks[0]);
+            for (unsigned int l = 1; l < Ops::LANES; ++l) {
+                v = Ops::Or(v, Ops::And(entries[l][w], masks[l]));
+            }
+            X[w] = Ops::Xor(X[w], v);
+        }
+        BlkMix<Ops, CHACHA>(X);
+    }
+}
+
+/**
+ * Computes Ops::LANES profile-0 Neoscrypt hashes of the INPUT_SIZE-byte
+ * inputs stored back to back in input, writing OUTPUT_SIZE bytes per hash.
+ */
+template <typename Ops>
+void Hash(const unsigned char* input, unsigned char* output)
+{
+    using Vec = typename Ops::Vec;
+    constexpr unsigned int LANES = Ops::LANES;
+
+    alignas(Ops::ALIGN) uint32_t words[WORDS * LANES];
+    uint32_t buf[WORDS];
+
+    for (unsigned int l = 0; l < LANES; ++l) {
+        const unsigned char* in = input + l * INPUT_SIZE;
+        neoscrypt_fastkdf(in, INPUT_SIZE, in, INPUT_SIZE, 32, reinterpret_cast<unsigned char*>(buf), sizeof(buf));
+        for (unsigned int w = 0; w < WORDS; ++w) words[w * LANES + l] = buf[w];
+    }
+
+    Vec X[WORDS], Z[WORDS];
+    for (unsigned int w = 0; w < WORDS; ++w) {
+        X[w] = Ops::Load(&words[w * LANES]);
+        Z[w] = X[w];
+    }
+
+    Vec masks[LANES];
+    for (unsigned int l = 0; l < LANES; ++l) {
+        for (unsigned int k = 0; k < LANES; ++k) words[k] = (k == l ? 0xFFFFFFFF : 0);
+        masks[l] = Ops::Load(words);
+    }
+
+    // ChaCha on Z first, Salsa on X second, sharing the scratchpad.
+    struct Scratchpad {
+        Vec entries[N * WORDS];
+    };
+    std::unique_ptr<Scratchpad> V(new Scratchpad);
+    SMix<Ops, true>(Z, V->entries, masks);
+    SMix<Ops, false>(X, V->entries, masks);
+
+    for (unsigned int w = 0; w < WORDS; ++w) {
+        Ops::Store(&words[w * LANES], Ops::Xor(X[w], Z[w]));
+    }
+
+    for (unsigned int l = 0; l < LANES; ++l) {
+        for (unsigned int w = 0; w < WORDS; ++w) buf[w] = words[w * LANES + l];
+        const unsigned char* in = input + l * INPUT_SIZE;
+        neoscrypt_fastkdf(in, INPUT_SIZE, reinterpret_cast<const unsigned char*>(buf), sizeof(buf), 32, output + l * OUTPUT_SIZE, OUTPUT_SIZE);
+    }
+}
+
+} // namespace neoscrypt_lanes
+
+#endif // BITCOIN_CRYPTO_NEOSCRYPT_LANES_H
@@ -0,0 +1,65 @@
+// Copyright (c) 2021 The SpaceXpanse developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/neoscrypt.h>
+
+#include <crypto/neoscrypt_lanes.h>
+
+#if defined(__SSE2__)
+namespace neoscrypt_sse2
+{
+void Hash_4way(const unsigned char* input, unsigned char* output);
+}
+#endif
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace neoscrypt_avx2
+{
+void Hash_8way(const unsigned char* input, unsigned char* output);
+}
+#endif
+
+namespace
+{
+/** Runs a multi-lane kernel over as many full groups of inputs as possible. */
+template <unsigned int LANES>
+void HashLanes(void (*kernel)(const unsigned char*, unsigned char*), const unsigned char*& passwords, unsigned char*& outputs, unsigned int& count)
+{
+    for (; count >= LANES; count -= LANES) {
+        kernel(passwords, outputs);
+        passwords += LANES * neoscrypt_lanes::INPUT_SIZE;
+        outputs += LANES * neoscrypt_lanes::OUTPUT_SIZE;
+    }
+}
+} // namespace
+
+void neoscrypt_multi(const unsigned char* passwords, unsigned char* outputs, unsigned int profile, unsigned int count)
+{
+    static const unsigned int exts = cpu_vec_exts();
+    neoscrypt_multi_exts(passwords, outputs, profile, count, exts);
+}
+
+void neoscrypt_multi_exts(const unsigned char* passwords, unsigned char* outputs, unsigned int profile, unsigned int count, unsigned int exts)
+{
+    (void)exts;
+
+    if (profile == 0) {
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+        if (exts & NEOSCRYPT_VEC_AVX2) {
+            HashLanes<8>(neoscrypt_avx2::Hash_8way, passwords, outputs, count);
+        }
+#endif
+#if defined(__SSE2__)
+        if (exts & NEOSCRYPT_VEC_SSE2) {
+            HashLanes<4>(neoscrypt_sse2::Hash_4way, passwords, outputs, count);
+        }
+#endif
+    }
+
+    for (; count > 0; --count) {
+        neoscrypt(passwords, outputs, profile);
+        passwords += neoscrypt_lanes::INPUT_SIZE;
+        outputs += neoscrypt_lanes::OUTPUT_SIZE;
+    }
+}
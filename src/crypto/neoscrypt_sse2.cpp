@@ -0,0 +1,38 @@
+// Copyright (c) 2021 The SpaceXpanse developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(__SSE2__)
+
+#include <stdint.h>
+#include <emmintrin.h>
+
+#include <crypto/neoscrypt_lanes.h>
+
+namespace neoscrypt_sse2 {
+namespace {
+
+struct Ops {
+    using Vec = __m128i;
+    static constexpr unsigned int LANES = 4;
+    static constexpr unsigned int ALIGN = 16;
+
+    static inline Vec Add(Vec x, Vec y) { return _mm_add_epi32(x, y); }
+    static inline Vec Xor(Vec x, Vec y) { return _mm_xor_si128(x, y); }
+    static inline Vec Or(Vec x, Vec y) { return _mm_or_si128(x, y); }
+    static inline Vec And(Vec x, Vec y) { return _mm_and_si128(x, y); }
+    static inline Vec Rotl(Vec x, int n) { return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+    static inline Vec Load(const uint32_t* p) { return _mm_load_si128((const __m128i*)p); }
+    static inline void Store(uint32_t* p, Vec x) { _mm_store_si128((__m128i*)p, x); }
+};
+
+} // namespace
+
+void Hash_4way(const unsigned char* input, unsigned char* output)
+{
+    neoscrypt_lanes::Hash<Ops>(input, output);
+}
+
+} // namespace neoscrypt_sse2
+
+#endif
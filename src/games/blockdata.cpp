@@ -0,0 +1,565 @@
+// Copyright (c) 2018-2021 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <games/blockdata.h>
+
+#include <amount.h>
+#include <chain.h>
+#include <checkqueue.h>
+#include <core_io.h>
+#include <key_io.h>
+#include <logging.h>
+#include <names/encoding.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <script/names.h>
+#include <script/script.h>
+#include <script/standard.h>
+#include <sync.h>
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+GameTransactionData::GameTransactionData (const CTransaction& tx)
+{
+  /* Determine if this is a name update at all; if it isn't, then there
+     is nothing to do for this transaction.  */
+  CNameScript nameOp;
+  for (const auto& out : tx.vout)
+    {
+      nameOp = CNameScript (out.scriptPubKey);
+      if (nameOp.isNameOp ())
+        break;
+    }
+  if (!nameOp.isNameOp () || !nameOp.isAnyUpdate ())
+    return;
+
+  /* Parse the value JSON.  */
+  const std::string valueStr = EncodeName (nameOp.getOpValue (),
+                                           NameEncoding::UTF8);
+  UniValue value;
+  if (!value.read (valueStr) || !value.isObject ())
+    {
+      /* This shouldn't actually happen, as the consensus rules check for
+         these conditions for name updates.  But if it does happen, we just
+         ignore it for here.  */
+      LogPrintf ("%s: invalid value ignored\n", __func__);
+      return;
+    }
+
+  /* Special case:  Handle admin commands.  */
+  const std::string name = EncodeName (nameOp.getOpName (), NameEncoding::UTF8);
+  if (name.substr (0, 2) == "g/")
+    {
+      isAdmin = true;
+      adminGame = name.substr (2);
+      assert (adminCmds.empty ());
+
+      for (size_t i = 0; i < value.size (); ++i)
+        if (value.getKeys ()[i] == "cmd")
+          adminCmds.push_back (value.getValues ()[i]);
+
+      return;
+    }
+  assert (!isAdmin);
+
+  /* Otherwise, we are only interested in p/ names.  */
+  if (name.substr (0, 2) != "p/")
+    return;
+
+  /* See if there are actually games mentioned in the update's value.  */
+  if (!value.exists ("g"))
+    return;
+  const UniValue& g = value["g"];
+  if (!g.isObject () || g.empty ())
+    return;
+
+  /* Prepare a template object that is the same for all games.  */
+  UniValue tmpl(UniValue::VOBJ);
+  tmpl.pushKV ("txid", tx.GetHash ().GetHex ());
+  tmpl.pushKV ("btxid", tx.GetBareHash ().GetHex ());
+  tmpl.pushKV ("name", name.substr (2));
+
+  UniValue inputs(UniValue::VARR);
+  for (const auto& in : tx.vin)
+    {
+      UniValue cur(UniValue::VOBJ);
+      cur.pushKV ("txid", in.prevout.hash.GetHex ());
+      cur.pushKV ("vout", static_cast<int> (in.prevout.n));
+      inputs.push_back (cur);
+    }
+  tmpl.pushKV ("inputs", inputs);
+
+  std::map<std::string, CAmount> outAmounts;
+  std::map<valtype, CAmount> burns;
+  for (const auto& out : tx.vout)
+    {
+      const CNameScript nameOp(out.scriptPubKey);
+      if (nameOp.isNameOp ())
+        continue;
+
+      CTxDestination dest;
+      if (ExtractDestination (out.scriptPubKey, dest))
+        {
+          const std::string addr = EncodeDestination (dest);
+          outAmounts[addr] += out.nValue;
+          continue;
+        }
+
+      valtype data;
+      if (IsBurn (out.scriptPubKey, data))
+        {
+          burns[data] += out.nValue;
+          continue;
+        }
+    }
+
+  UniValue out(UniValue::VOBJ);
+  for (const auto& entry : outAmounts)
+    out.pushKV (entry.first, ValueFromAmount (entry.second));
+  tmpl.pushKV ("out", out);
+
+  /* Fill the per-game moves into the template.  */
+  for (size_t i = 0; i < value.size (); ++i)
+    {
+      if (value.getKeys ()[i] != "g")
+        continue;
+      const auto& g = value.getValues ()[i];
+      if (!g.isObject ())
+        continue;
+
+      for (size_t j = 0; j < g.size (); ++j)
+        {
+          UniValue obj = tmpl;
+          obj.pushKV ("move", g.getValues ()[j]);
+
+          const std::string& game = g.getKeys ()[j];
+
+          const valtype burnData = ToByteVector ("g/" + game);
+          const auto mitBurn = burns.find (burnData);
+          if (mitBurn != burns.end ())
+            obj.pushKV ("burnt", ValueFromAmount (mitBurn->second));
+          else
+            obj.pushKV ("burnt", 0);
+
+          auto mit = moves.find (game);
+          if (mit == moves.end ())
+            moves.emplace (game, obj);
+          else
+            mit->second = obj;
+        }
+    }
+}
+
+namespace
+{
+
+/**
+ * Simple scanner for JSON objects that extracts the keys of "g" objects
+ * and skips over everything else.
+ */
+class MoveGameScanner
+{
+
+private:
+
+  /** The string being scanned.  */
+  const std::string& str;
+  /** The current position in the string.  */
+  size_t pos = 0;
+
+  void
+  SkipWhitespace ()
+  {
+    while (pos < str.size () && (str[pos] == ' ' || str[pos] == '\t'
+                                  || str[pos] == '\n' || str[pos] == '\r'))
+      ++pos;
+  }
+
+  /**
+   * Reads a string at the current position.  If it contains an escape
+   * sequence, it is skipped but false is returned, unless skipEscapes
+   * is set.
+   */
+  bool
+  ReadString (std::string& out, const bool skipEscapes)
+  {
+    if (pos >= str.size () || str[pos] != '"')
+      return false;
+
+    const size_t start = ++pos;
+    bool escapes = false;
+    while (pos < str.size () && str[pos] != '"')
+      {
+        if (str[pos] == '\\')
+          {
+            escapes = true;
+            ++pos;
+          }
+        ++pos;
+      }
+    if (pos >= str.size ())
+      return false;
+
+    out = str.substr (start, pos - start);
+    ++pos;
+
+    return skipEscapes || !escapes;
+  }
+
+  /**
+   * Skips over a JSON value at the current position.  Nested objects and
+   * arrays are only checked for balanced brackets.
+   */
+  bool
+  SkipValue ()
+  {
+    if (pos >= str.size ())
+      return false;
+
+    std::string dummy;
+    if (str[pos] == '"')
+      return ReadString (dummy, true);
+
+    if (str[pos] == '{' || str[pos] == '[')
+      {
+        std::vector<char> closing;
+        while (pos < str.size ())
+          {
+            switch (str[pos])
+              {
+              case '"':
+                if (!ReadString (dummy, true))
+                  return false;
+                continue;
+              case '{':
+                closing.push_back ('}');
+                break;
+              case '[':
+                closing.push_back (']');
+                break;
+              case '}':
+              case ']':
+                if (closing.empty () || closing.back () != str[pos])
+                  return false;
+                closing.pop_back ();
+                break;
+              default:
+                break;
+              }
+
+            ++pos;
+            if (closing.empty ())
+              return true;
+          }
+
+        return false;
+      }
+
+    /* Anything else is a number or literal, which extends until the next
+       delimiter.  */
+    const size_t start = pos;
+    while (pos < str.size () && str[pos] != ',' && str[pos] != '}'
+             && str[pos] != ']' && str[pos] != ' ' && str[pos] != '\t'
+             && str[pos] != '\n' && str[pos] != '\r')
+      ++pos;
+
+    return pos > start;
+  }
+
+  /**
+   * Scans the members of an object at the current position.  For each
+   * key, the callback is invoked with the position at the start of the
+   * value, and has to advance past it.
+   */
+  template <typename Fcn>
+    bool
+    ScanObject (const Fcn& onMember)
+  {
+    if (pos >= str.size () || str[pos] != '{')
+      return false;
+    ++pos;
+
+    SkipWhitespace ();
+    if (pos < str.size () && str[pos] == '}')
+      {
+        ++pos;
+        return true;
+      }
+
+    while (true)
+      {
+        std::string key;
+        SkipWhitespace ();
+        if (!ReadString (key, false))
+          return false;
+
+        SkipWhitespace ();
+        if (pos >= str.size () || str[pos] != ':')
+          return false;
+        ++pos;
+        SkipWhitespace ();
+
+        if (!onMember (key))
+          return false;
+
+        SkipWhitespace ();
+        if (pos >= str.size ())
+          return false;
+        if (str[pos] == '}')
+          {
+            ++pos;
+            return true;
+          }
+        if (str[pos] != ',')
+          return false;
+        ++pos;
+      }
+  }
+
+public:
+
+  explicit MoveGameScanner (const std::string& s)
+    : str(s)
+  {}
+
+  bool
+  Scan (std::set<std::string>& gameIds)
+  {
+    SkipWhitespace ();
+    const bool ok = ScanObject ([this, &gameIds] (const std::string& key)
+      {
+        if (key != "g" || pos >= str.size () || str[pos] != '{')
+          return SkipValue ();
+
+        return ScanObject ([this, &gameIds] (const std::string& game)
+          {
+            gameIds.insert (game);
+            return SkipValue ();
+          });
+      });
+    if (!ok)
+      return false;
+
+    SkipWhitespace ();
+    return pos == str.size ();
+  }
+
+};
+
+} // anonymous namespace
+
+bool
+ExtractMoveGameIds (const std::string& value, std::set<std::string>& gameIds)
+{
+  gameIds.clear ();
+  MoveGameScanner scanner(value);
+  return scanner.Scan (gameIds);
+}
+
+namespace
+{
+
+/**
+ * Closure for the check queue that extracts the GameTransactionData of a range
+ * of transactions in a block.  The results are written to the slots passed
+ * in, which (like the block) must outlive the check.  If extracting the data
+ * fails for a transaction, the check stops and leaves the remaining slots
+ * empty, so that the caller can redo them and get the exception.
+ */
+class GameTxDataCheck
+{
+
+private:
+
+  const CBlock* block = nullptr;
+  std::optional<GameTransactionData>* txData = nullptr;
+  size_t begin = 0;
+  size_t end = 0;
+
+public:
+
+  GameTxDataCheck () = default;
+
+  explicit GameTxDataCheck (const CBlock& b,
+                            std::optional<GameTransactionData>* d,
+                            const size_t bg, const size_t e)
+    : block(&b), txData(d), begin(bg), end(e)
+  {}
+
+  bool
+  operator() ()
+  {
+    try
+      {
+        for (size_t i = begin; i < end; ++i)
+          txData[i].emplace (*block->vtx[i]);
+      }
+    catch (...)
+      {
+        return false;
+      }
+
+    return true;
+  }
+
+  void
+  swap (GameTxDataCheck& check)
+  {
+    std::swap (block, check.block);
+    std::swap (txData, check.txData);
+    std::swap (begin, check.begin);
+    std::swap (end, check.end);
+  }
+
+};
+
+/** Each check already covers a range of transactions, so hand them out
+    one by one.  */
+CCheckQueue<GameTxDataCheck> gameDataQueue(1);
+
+/**
+ * Held while a caller uses the check queue.  The queue only serves one
+ * control at a time, so callers that find it busy extract the data on their
+ * own thread instead of waiting for the other one to finish.
+ */
+Mutex gameDataQueueMutex;
+
+} // anonymous namespace
+
+void
+StartGameBlockDataWorkerThreads (const int threadsNum)
+{
+  gameDataQueue.StartWorkerThreads (threadsNum, "gamedata");
+}
+
+void
+StopGameBlockDataWorkerThreads ()
+{
+  gameDataQueue.StopWorkerThreads ();
+}
+
+GameBlockData::GameBlockData (const CBlock& block)
+  : rngseed(block.GetRngSeed ())
+{
+  const size_t numTx = block.vtx.size ();
+  std::vector<std::optional<GameTransactionData>> txData(numTx);
+
+  TRY_LOCK (gameDataQueueMutex, lockQueue);
+  if (numTx > TX_PER_CHECK && lockQueue)
+    {
+      std::vector<GameTxDataCheck> checks;
+      for (size_t i = 0; i < numTx; i += TX_PER_CHECK)
+        checks.emplace_back (block, txData.data (), i,
+                             std::min (i + TX_PER_CHECK, numTx));
+
+      CCheckQueueControl<GameTxDataCheck> control(&gameDataQueue);
+      control.Add (checks);
+      control.Wait ();
+    }
+
+  /* Extract the data for small blocks or while the queue is busy, as well as
+     for any transactions that were skipped above because one failed.  In the latter case, this
+     throws the failure's exception on our thread.  */
+  for (size_t i = 0; i < numTx; ++i)
+    if (!txData[i])
+      txData[i].emplace (*block.vtx[i]);
+
+  /* Merge the per-transaction data in block order.  */
+  for (size_t i = 0; i < numTx; ++i)
+    {
+      assert (txData[i]);
+      const auto& data = *txData[i];
+
+      for (const auto& entry : data.GetMovesPerGame ())
+        {
+          auto mit = moves.find (entry.first);
+          if (mit == moves.end ())
+            mit = moves.emplace (entry.first,
+                                 UniValue (UniValue::VARR)).first;
+          mit->second.push_back (entry.second);
+        }
+
+      if (data.IsAdminCommand () && !data.GetAdminCommands ().empty ())
+        {
+          auto mit = adminCmds.find (data.GetAdminGame ());
+          if (mit == adminCmds.end ())
+            mit = adminCmds.emplace (data.GetAdminGame (),
+                                     UniValue (UniValue::VARR)).first;
+
+          for (const auto& cmd : data.GetAdminCommands ())
+            {
+              UniValue cmdJson(UniValue::VOBJ);
+              cmdJson.pushKV ("txid", block.vtx[i]->GetHash ().GetHex ());
+              cmdJson.pushKV ("cmd", cmd);
+              mit->second.push_back (cmdJson);
+            }
+        }
+    }
+}
+
+UniValue
+GameBlockData::GetBlockJson (const CBlockIndex& pindex) const
+{
+  UniValue res(UniValue::VOBJ);
+  res.pushKV ("hash", pindex.GetBlockHash ().GetHex ());
+  if (pindex.pprev != nullptr)
+    res.pushKV ("parent", pindex.pprev->GetBlockHash ().GetHex ());
+  res.pushKV ("timestamp", pindex.GetBlockTime ());
+  res.pushKV ("rngseed", rngseed.GetHex ());
+  res.pushKV ("height", pindex.nHeight);
+  res.pushKV ("mediantime", pindex.GetMedianTimePast ());
+
+  return res;
+}
+
+void
+GameBlockData::AddGameJson (const std::string& game, UniValue& obj) const
+{
+  const auto mitMv = moves.find (game);
+  if (mitMv == moves.end ())
+    obj.pushKV ("moves", UniValue (UniValue::VARR));
+  else
+    obj.pushKV ("moves", mitMv->second);
+
+  const auto mitCmd = adminCmds.find (game);
+  if (mitCmd == adminCmds.end ())
+    obj.pushKV ("admin", UniValue (UniValue::VARR));
+  else
+    obj.pushKV ("admin", mitCmd->second);
+}
+
+std::shared_ptr<const GameBlockData>
+GameBlockDataCache::Get (const CBlock& block)
+{
+  const uint256 hash = block.GetHash ();
+
+  {
+    LOCK (cs);
+    for (auto it = entries.begin (); it != entries.end (); ++it)
+      if (it->first == hash)
+        {
+          entries.splice (entries.begin (), entries, it);
+          return it->second;
+        }
+  }
+
+  /* Extract the data without holding the lock, so that concurrent
+     requests for other blocks are not blocked.  If the same block is
+     requested concurrently, it may be extracted twice; in that case we
+     just keep the entry that was added first.  */
+  auto data = std::make_shared<const GameBlockData> (block);
+
+  LOCK (cs);
+  for (const auto& entry : entries)
+    if (entry.first == hash)
+      return entry.second;
+
+  entries.emplace_front (hash, data);
+  while (entries.size () > maxSize)
+    entries.pop_back ();
+
+  return data;
+}
@@ -0,0 +1,225 @@
+// Copyright (c) 2018-2021 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_GAMES_BLOCKDATA_H
+#define BITCOIN_GAMES_BLOCKDATA_H
+
+#include <sync.h>
+#include <uint256.h>
+
+#include <univalue.h>
+
+#include <cassert>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+class CTransaction;
+
+/**
+ * Helper class that analyses a single transaction and extracts the data
+ * from it that is relevant for the game notifications.
+ */
+class GameTransactionData
+{
+
+private:
+
+  /**
+   * Type for the map that holds moves for each game.  Note that a single
+   * transaction may contain multiple moves for a single game, namely if
+   * it has duplicate JSON keys in the "g" object, or multiple "g" entries.
+   * In those cases, we want to always store/send the last of them.
+   */
+  using MovePerGame = std::map<std::string, UniValue>;
+
+  /** Move data for each game.  */
+  MovePerGame moves;
+
+  /** Set to true if this is an admin command.  */
+  bool isAdmin = false;
+  /** Game ID for which this is an admin command.  */
+  std::string adminGame;
+  /**
+   * The array of admin command data (if any).  There can be multiple entries
+   * if the move had duplicate "cmd" fields.
+   */
+  std::vector<UniValue> adminCmds;
+
+public:
+
+  /**
+   * Construct this by analysing a given transaction.
+   */
+  explicit GameTransactionData (const CTransaction& tx);
+
+  GameTransactionData () = delete;
+  GameTransactionData (const GameTransactionData&) = delete;
+  void operator= (const GameTransactionData&) = delete;
+
+  const MovePerGame&
+  GetMovesPerGame () const
+  {
+    return moves;
+  }
+
+  bool
+  IsAdminCommand () const
+  {
+    return isAdmin;
+  }
+
+  const std::string&
+  GetAdminGame () const
+  {
+    assert (isAdmin);
+    return adminGame;
+  }
+
+  const std::vector<UniValue>&
+  GetAdminCommands () const
+  {
+    assert (isAdmin);
+    return adminCmds;
+  }
+
+};
+
+/**
+ * Extracts the game IDs of all moves in a name value (i.e. the keys of
+ * the "g" objects) without fully parsing the JSON.  Returns false if the
+ * value cannot be handled by this simple scanner (e.g. if it is not valid
+ * JSON or has escape sequences in keys).  In that case the value has to
+ * be parsed fully to determine the games.
+ */
+bool ExtractMoveGameIds (const std::string& value,
+                         std::set<std::string>& gameIds);
+
+/**
+ * The game moves and admin commands extracted from all transactions of
+ * a block, together with the block's RNG seed.  This does not depend on
+ * the tracked games or the type of notification, so that it can be computed
+ * once for each block and then shared between attach, detach and
+ * game_sendupdates notifications for all games.
+ */
+class GameBlockData
+{
+
+private:
+
+  /**
+   * The number of transactions handled by each job on the worker threads
+   * when extracting the data.  Blocks with no more than that are processed
+   * on the calling thread only.
+   */
+  static constexpr size_t TX_PER_CHECK = 64;
+
+public:
+
+  /** The block's RNG seed (see CBlockHeader::GetRngSeed).  */
+  uint256 rngseed;
+
+  /** Array of moves for each game that has any in the block.  */
+  std::map<std::string, UniValue> moves;
+  /** Array of admin commands for each game that has any in the block.  */
+  std::map<std::string, UniValue> adminCmds;
+
+  /**
+   * Extracts the data from the given block.  The transactions are
+   * parsed in parallel on the game-data worker threads (see
+   * StartGameBlockDataWorkerThreads), and the results merged in block order.
+   */
+  explicit GameBlockData (const CBlock& block);
+
+  /**
+   * Constructs the instance from already extracted data (e.g. as stored
+   * in the game move index).
+   */
+  explicit GameBlockData (const uint256& seed,
+                          std::map<std::string, UniValue> m,
+                          std::map<std::string, UniValue> a)
+    : rngseed(seed), moves(std::move (m)), adminCmds(std::move (a))
+  {}
+
+  GameBlockData () = delete;
+  GameBlockData (const GameBlockData&) = delete;
+  void operator= (const GameBlockData&) = delete;
+
+  /**
+   * Returns the "block" object of game block notifications for this
+   * block, which has the given block index entry.
+   */
+  UniValue GetBlockJson (const CBlockIndex& pindex) const;
+
+  /**
+   * Adds the "moves" and "admin" arrays for the given game to a
+   * notification object.  They are empty if the game has no moves
+   * or admin commands in this block.
+   */
+  void AddGameJson (const std::string& game, UniValue& obj) const;
+
+};
+
+/**
+ * Small LRU cache of the extracted GameBlockData, keyed by block hash.
+ */
+class GameBlockDataCache
+{
+
+private:
+
+  /** Cached entries with the most recently used one at the front.  */
+  using EntryList
+      = std::list<std::pair<uint256, std::shared_ptr<const GameBlockData>>>;
+
+  /** Maximum number of entries to keep.  */
+  const size_t maxSize;
+
+  /** The cached entries.  */
+  EntryList entries GUARDED_BY (cs);
+
+  /** Lock for this instance.  */
+  mutable Mutex cs;
+
+public:
+
+  /**
+   * Default size of the cache.  It is enough to cover the blocks of a
+   * typical reorg, so that detaching and reattaching them (as well as
+   * game_sendupdates requests by the game daemons right afterwards) reuse
+   * the data.
+   */
+  static constexpr size_t DEFAULT_SIZE = 16;
+
+  explicit GameBlockDataCache (const size_t s = DEFAULT_SIZE)
+    : maxSize(s)
+  {}
+
+  GameBlockDataCache (const GameBlockDataCache&) = delete;
+  void operator= (const GameBlockDataCache&) = delete;
+
+  /**
+   * Returns the data for the given block, extracting it (without holding
+   * the lock) if it is not yet cached.
+   */
+  std::shared_ptr<const GameBlockData> Get (const CBlock& block);
+
+};
+
+/**
+ * Starts the worker threads that extract GameBlockData in parallel.  Without
+ * them, the data is extracted on the thread requesting it.
+ */
+void StartGameBlockDataWorkerThreads (int threadsNum);
+
+/** Stops the worker threads for extracting GameBlockData.  */
+void StopGameBlockDataWorkerThreads ();
+
+#endif // BITCOIN_GAMES_BLOCKDATA_H
@@ -16,6 +16,8 @@
 #include <util/threadnames.h>
 #include <util/translation.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <memory>
 #include <stdio.h>
@@ -36,6 +38,12 @@
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
 
+/**
+ * Maximum number of bytes of a chunked reply that may be waiting to be
+ * sent to the client before WriteReplyChunk blocks.
+ */
+static const size_t MAX_CHUNKED_REPLY_BUFFER = 1 << 20;
+
 /** HTTP request work item */
 class HTTPWorkItem final : public HTTPClosure
 {
@@ -137,6 +145,8 @@ static struct evhttp* eventHTTP = nullptr;
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
 static std::unique_ptr<WorkQueue<HTTPClosure>> g_work_queue{nullptr};
+//! Seconds a chunked reply may stall before it is aborted (-rpcservertimeout)
+static int g_chunked_reply_timeout{DEFAULT_HTTP_SERVER_TIMEOUT};
 //! Handlers for (sub)paths
 static std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -378,7 +388,8 @@ bool InitHTTPServer()
         return false;
     }
 
-    evhttp_set_timeout(http, gArgs.GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
+    g_chunked_reply_timeout = gArgs.GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT);
+    evhttp_set_timeout(http, g_chunked_reply_timeout);
     evhttp_set_max_headers_size(http, MAX_HEADERS_SIZE);
     evhttp_set_max_body_size(http, MAX_SIZE);
     evhttp_set_gencb(http, http_request_cb, nullptr);
@@ -509,6 +520,10 @@ HTTPRequest::HTTPRequest(struct evhttp_request* _req, bool _replySent) : req(_re
 
 HTTPRequest::~HTTPRequest()
 {
+    if (!replySent && chunked) {
+        // A chunked reply has been started; just terminate it.
+        EndChunkedReply();
+    }
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
@@ -560,9 +575,25 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
  * Replies must be sent in the main loop in the main http thread,
  * this cannot be done from worker threads.
  */
+/** Re-enable reading from the socket once a reply has been started. This is
+ * the second part of the libevent workaround in http_request_cb.
+ */
+static void ReenableRequestRead(struct evhttp_request* req)
+{
+    if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+        evhttp_connection* conn = evhttp_request_get_connection(req);
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    }
+}
+
 void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
 {
-    assert(!replySent && req);
+    assert(!replySent && req && !chunked);
     if (ShutdownRequested()) {
         WriteHeader("Connection", "close");
     }
@@ -573,17 +604,175 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     auto req_copy = req;
     HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
-        // Re-enable reading from the socket. This is the second part of the libevent
-        // workaround above.
-        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
-            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
-            if (conn) {
-                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
-                if (bev) {
-                    bufferevent_enable(bev, EV_READ | EV_WRITE);
-                }
+        ReenableRequestRead(req_copy);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
+/** State of a chunked reply, shared between the worker thread producing the
+ * body and the main http thread sending it.
+ */
+struct HTTPChunkedReply {
+    Mutex cs;
+    std::condition_variable cv;
+    /** Bytes handed to the main thread but not yet passed to libevent */
+    size_t pending GUARDED_BY(cs){0};
+    /** Bytes in the connection's output buffer, not yet written to the socket */
+    size_t unsent GUARDED_BY(cs){0};
+    /** Set when the client connection was closed */
+    bool closed GUARDED_BY(cs){false};
+
+    /** Heap-allocated reference to this object that is passed to the close
+     * callback of the connection. Only accessed from the main http thread.
+     */
+    std::shared_ptr<HTTPChunkedReply>* keepalive{nullptr};
+
+    void SetClosed()
+    {
+        {
+            LOCK(cs);
+            closed = true;
+        }
+        cv.notify_all();
+    }
+
+    bool IsClosed()
+    {
+        LOCK(cs);
+        return closed;
+    }
+
+    /** Update the number of unsent bytes from the connection's buffer */
+    void UpdateUnsent(struct evhttp_request* req)
+    {
+        size_t len = 0;
+        evhttp_connection* conn = evhttp_request_get_connection(req);
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) len = evbuffer_get_length(bufferevent_get_output(bev));
+        }
+        {
+            LOCK(cs);
+            unsent = len;
+        }
+        cv.notify_all();
+    }
+};
+
+static void http_chunked_close_cb(struct evhttp_connection* conn, void* arg)
+{
+    auto* keepalive = static_cast<std::shared_ptr<HTTPChunkedReply>*>(arg);
+    (*keepalive)->keepalive = nullptr;
+    (*keepalive)->SetClosed();
+    delete keepalive;
+}
+
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+static void http_chunked_flushed_cb(struct evhttp_connection* conn, void* arg)
+{
+    auto* state = static_cast<HTTPChunkedReply*>(arg);
+    {
+        LOCK(state->cs);
+        state->unsent = 0;
+    }
+    state->cv.notify_all();
+}
+#endif
+
+void HTTPRequest::StartChunkedReply(int nStatus)
+{
+    assert(!replySent && req && !chunked);
+    if (ShutdownRequested()) {
+        WriteHeader("Connection", "close");
+    }
+    chunked = std::make_shared<HTTPChunkedReply>();
+    auto req_copy = req;
+    auto state = chunked;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus, state]{
+        evhttp_send_reply_start(req_copy, nStatus, nullptr);
+        ReenableRequestRead(req_copy);
+        // Get notified if the client goes away, so that the worker can
+        // stop producing data nobody will read.
+        evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+        if (conn) {
+            state->keepalive = new std::shared_ptr<HTTPChunkedReply>(state);
+            evhttp_connection_set_closecb(conn, http_chunked_close_cb, state->keepalive);
+        } else {
+            state->SetClosed();
+        }
+    });
+    ev->trigger(nullptr);
+}
+
+bool HTTPRequest::WriteReplyChunk(const std::string& data)
+{
+    assert(!replySent && req && chunked);
+    {
+        WAIT_LOCK(chunked->cs, lock);
+        // Give up if the client does not read anything for the server
+        // timeout, so that a stalled client cannot hold on to this worker
+        // thread indefinitely. libevent closes the connection eventually.
+        const auto timeout = std::chrono::seconds(g_chunked_reply_timeout);
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        size_t buffered = chunked->pending + chunked->unsent;
+        while (!chunked->closed && chunked->pending + chunked->unsent > MAX_CHUNKED_REPLY_BUFFER) {
+            if (ShutdownRequested()) return false;
+            const auto now = std::chrono::steady_clock::now();
+            if (chunked->pending + chunked->unsent < buffered) {
+                buffered = chunked->pending + chunked->unsent;
+                deadline = now + timeout;
+            } else if (now >= deadline) {
+                LogPrint(BCLog::HTTP, "Aborting chunked reply after the client stalled for %d seconds\n", g_chunked_reply_timeout);
+                // Later writes for this reply then fail right away.
+                chunked->closed = true;
+                return false;
             }
+            chunked->cv.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        if (chunked->closed || ShutdownRequested()) return false;
+        chunked->pending += data.size();
+    }
+    if (data.empty()) return true;
+
+    auto req_copy = req;
+    auto state = chunked;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, state, data]{
+        {
+            LOCK(state->cs);
+            state->pending -= data.size();
+            if (state->closed) return;
+        }
+        struct evbuffer* evb = evbuffer_new();
+        evbuffer_add(evb, data.data(), data.size());
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+        evhttp_send_reply_chunk_with_cb(req_copy, evb, http_chunked_flushed_cb, state.get());
+#else
+        evhttp_send_reply_chunk(req_copy, evb);
+#endif
+        evbuffer_free(evb);
+        state->UpdateUnsent(req_copy);
+    });
+    ev->trigger(nullptr);
+    return true;
+}
+
+void HTTPRequest::EndChunkedReply()
+{
+    assert(!replySent && req && chunked);
+    auto req_copy = req;
+    auto state = chunked;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, state]{
+        if (state->keepalive) {
+            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+            if (conn) evhttp_connection_set_closecb(conn, nullptr, nullptr);
+            delete state->keepalive;
+            state->keepalive = nullptr;
         }
+        // If the connection failed, libevent detached the unfinished request
+        // from it and frees it here instead.
+        evhttp_send_reply_end(req_copy);
     });
     ev->trigger(nullptr);
     replySent = true;
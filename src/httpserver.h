@@ -7,6 +7,7 @@
 
 #include <string>
 #include <functional>
+#include <memory>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -16,6 +17,7 @@ struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPChunkedReply;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -58,6 +60,8 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    /** State shared with the event thread while a chunked reply is sent */
+    std::shared_ptr<HTTPChunkedReply> chunked;
 
 public:
     explicit HTTPRequest(struct evhttp_request* req, bool replySent = false);
@@ -113,6 +117,29 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a chunked reply, for streaming a body that is too large to be
+     * built in memory. Headers must be written before calling this; the body
+     * is then sent with WriteReplyChunk and finished with EndChunkedReply.
+     * WriteReply must not be used for the same request.
+     */
+    void StartChunkedReply(int nStatus);
+
+    /**
+     * Send the next part of a chunked reply. Blocks while too much data is
+     * still waiting to be written to the client. Returns false if the client
+     * has disconnected, has not read anything for the server timeout, or
+     * shutdown was requested, in which case the caller should stop producing
+     * data and call EndChunkedReply.
+     */
+    bool WriteReplyChunk(const std::string& data);
+
+    /**
+     * Finish a chunked reply. As with WriteReply, the request is transferred
+     * back to the main thread, and no other methods must be called after this.
+     */
+    void EndChunkedReply();
 };
 
 /** Event handler closure.
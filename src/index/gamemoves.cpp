@@ -0,0 +1,231 @@
+// Copyright (c) 2021 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/gamemoves.h>
+
+#include <chain.h>
+#include <games/blockdata.h>
+#include <logging.h>
+#include <primitives/block.h>
+#include <serialize.h>
+#include <util/system.h>
+
+#include <uint256.h>
+
+#include <univalue.h>
+
+#include <map>
+#include <utility>
+
+/** Database "key prefix" for the per-block entries.  */
+constexpr char DB_BLOCK = 'b';
+/** Database "key prefix" for the per-game entries.  */
+constexpr char DB_GAME = 'g';
+
+namespace
+{
+
+/**
+ * Database key of a per-game entry.  The height is serialised big-endian,
+ * so that the entries of each game are stored in height order.
+ */
+struct GameKey
+{
+
+  std::string game;
+  uint32_t height;
+
+  GameKey () = default;
+
+  explicit GameKey (const std::string& g, const int h)
+    : game(g), height(h)
+  {}
+
+  template <typename Stream>
+    void
+    Serialize (Stream& s) const
+  {
+    s << DB_GAME << game;
+    ser_writedata32be (s, height);
+  }
+
+  template <typename Stream>
+    void
+    Unserialize (Stream& s)
+  {
+    char prefix;
+    s >> prefix >> game;
+    height = ser_readdata32be (s);
+  }
+
+};
+
+/** Per-block entry in the database.  */
+struct BlockEntry
+{
+
+  uint256 hash;
+  uint256 rngseed;
+
+  SERIALIZE_METHODS (BlockEntry, obj)
+  {
+    READWRITE (obj.hash, obj.rngseed);
+  }
+
+};
+
+/**
+ * Per-game entry in the database, with the moves and admin commands as
+ * serialised JSON arrays.
+ */
+struct GameEntry
+{
+
+  uint256 hash;
+  std::string moves;
+  std::string admin;
+
+  SERIALIZE_METHODS (GameEntry, obj)
+  {
+    READWRITE (obj.hash, obj.moves, obj.admin);
+  }
+
+};
+
+} // anonymous namespace
+
+class GameMoveIndex::DB : public BaseIndex::DB
+{
+
+public:
+
+  explicit DB (const size_t cache_size, const bool memory, const bool wipe)
+    : BaseIndex::DB (gArgs.GetDataDirNet () / "indexes" / "gamemoves",
+                     cache_size, memory, wipe)
+  {}
+
+  bool
+  ReadBlockEntry (const int height, BlockEntry& entry) const
+  {
+    return Read (std::make_pair (DB_BLOCK, static_cast<uint32_t> (height)),
+                 entry);
+  }
+
+  bool
+  ReadGameEntry (const std::string& game, const int height,
+                 GameEntry& entry) const
+  {
+    return Read (GameKey (game, height), entry);
+  }
+
+  bool WriteBlockData (const CBlockIndex& pindex, const GameBlockData& data);
+
+};
+
+bool
+GameMoveIndex::DB::WriteBlockData (const CBlockIndex& pindex,
+                                   const GameBlockData& data)
+{
+  const uint256 hash = pindex.GetBlockHash ();
+
+  CDBBatch batch(*this);
+  batch.Write (std::make_pair (DB_BLOCK, static_cast<uint32_t> (pindex.nHeight)),
+               BlockEntry {hash, data.rngseed});
+
+  std::map<std::string, GameEntry> entries;
+  for (const auto& mv : data.moves)
+    entries[mv.first].moves = mv.second.write ();
+  for (const auto& cmd : data.adminCmds)
+    entries[cmd.first].admin = cmd.second.write ();
+
+  for (auto& entry : entries)
+    {
+      entry.second.hash = hash;
+      batch.Write (GameKey (entry.first, pindex.nHeight), entry.second);
+    }
+
+  return WriteBatch (batch);
+}
+
+GameMoveIndex::GameMoveIndex (const size_t cache_size, const bool memory,
+                              const bool wipe)
+  : db(std::make_unique<GameMoveIndex::DB> (cache_size, memory, wipe))
+{}
+
+GameMoveIndex::~GameMoveIndex () = default;
+
+bool
+GameMoveIndex::WriteBlock (const CBlock& block, const CBlockIndex* pindex)
+{
+  const GameBlockData data(block);
+  return db->WriteBlockData (*pindex, data);
+}
+
+BaseIndex::DB&
+GameMoveIndex::GetDB () const
+{
+  return *db;
+}
+
+namespace
+{
+
+/**
+ * Parses a JSON array stored in a game entry.  An empty string means
+ * that there is no data.
+ */
+bool
+ParseEntryArray (const std::string& str, UniValue& arr)
+{
+  if (str.empty ())
+    {
+      arr = UniValue (UniValue::VARR);
+      return true;
+    }
+
+  return arr.read (str) && arr.isArray ();
+}
+
+} // anonymous namespace
+
+std::shared_ptr<const GameBlockData>
+GameMoveIndex::FindBlockData (const CBlockIndex& pindex,
+                              const std::set<std::string>& games) const
+{
+  const uint256 hash = pindex.GetBlockHash ();
+
+  BlockEntry blk;
+  if (!db->ReadBlockEntry (pindex.nHeight, blk) || blk.hash != hash)
+    return nullptr;
+
+  std::map<std::string, UniValue> moves;
+  std::map<std::string, UniValue> adminCmds;
+  for (const auto& game : games)
+    {
+      GameEntry entry;
+      if (!db->ReadGameEntry (game, pindex.nHeight, entry)
+            || entry.hash != hash)
+        continue;
+
+      UniValue mv, cmd;
+      if (!ParseEntryArray (entry.moves, mv)
+            || !ParseEntryArray (entry.admin, cmd))
+        {
+          LogPrintf ("%s: invalid entry for game %s at height %d\n",
+                     GetName (), game, pindex.nHeight);
+          return nullptr;
+        }
+
+      if (!mv.empty ())
+        moves.emplace (game, std::move (mv));
+      if (!cmd.empty ())
+        adminCmds.emplace (game, std::move (cmd));
+    }
+
+  return std::make_shared<const GameBlockData> (blk.rngseed,
+                                                std::move (moves),
+                                                std::move (adminCmds));
+}
+
+std::unique_ptr<GameMoveIndex> g_game_move_index;
@@ -0,0 +1,78 @@
+// Copyright (c) 2021 The Xaya developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_GAMEMOVES_H
+#define BITCOIN_INDEX_GAMEMOVES_H
+
+#include <index/base.h>
+
+#include <memory>
+#include <set>
+#include <string>
+
+class CBlockIndex;
+class GameBlockData;
+
+/** Default value for the -gamemoveindex argument.  */
+static constexpr bool DEFAULT_GAMEMOVEINDEX = false;
+
+/** Maximum size of the DB cache for the game-move index.  */
+static constexpr int64_t MAX_GAMEMOVE_CACHE = 1024;
+
+/**
+ * This keeps an index of the game moves and admin commands in each block,
+ * stored separately per game and block height.  It allows constructing
+ * the notifications for game_sendupdates from just the data of the
+ * requested game, instead of reading and parsing the full blocks from disk.
+ *
+ * For each block, the index also stores the block hash and RNG seed
+ * (which cannot be computed from the block index alone).  All entries
+ * are keyed by height and contain the hash of their block.  When blocks
+ * are detached, their entries are not removed; instead, lookups ignore
+ * all entries whose hash does not match the requested block.
+ */
+class GameMoveIndex : public BaseIndex
+{
+
+private:
+
+  class DB;
+
+  const std::unique_ptr<DB> db;
+
+protected:
+
+    bool WriteBlock (const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB () const override;
+
+    const char*
+    GetName () const override
+    {
+      return "gamemoves";
+    }
+
+public:
+
+    /**
+     * Constructs the index, which becomes available to be queried.
+     */
+    explicit GameMoveIndex (size_t cache_size, bool memory, bool wipe);
+
+    ~GameMoveIndex ();
+
+    /**
+     * Looks up the moves and admin commands of the given games in the given
+     * block, together with its RNG seed.  Returns null if the block has not
+     * been indexed (yet).
+     */
+    std::shared_ptr<const GameBlockData> FindBlockData (
+        const CBlockIndex& pindex, const std::set<std::string>& games) const;
+
+};
+
+/** The global game-move index.  May be null.  */
+extern std::unique_ptr<GameMoveIndex> g_game_move_index;
+
+#endif // BITCOIN_INDEX_GAMEMOVES_H
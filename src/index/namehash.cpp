@@ -4,15 +4,21 @@
 
 #include <index/namehash.h>
 
+#include <coins.h>
 #include <hash.h>
+#include <names/common.h>
 #include <script/names.h>
+#include <validation.h>
 
+#include <algorithm>
 #include <utility>
-#include <vector>
 
 /** Database "key prefix" for the actual hash entries.  */
 constexpr char DB_HASH = 'h';
 
+/** Number of names written in one batch when building from the name DB.  */
+constexpr size_t SNAPSHOT_BATCH_SIZE = 10000;
+
 class NameHashIndex::DB : public BaseIndex::DB
 {
 
@@ -29,10 +35,47 @@ public:
     return Read (std::make_pair (DB_HASH, hash), name);
   }
 
+  void ReadPreimages (std::vector<uint256> hashes,
+                      std::map<uint256, valtype>& names);
+
   bool WritePreimages (const std::vector<std::pair<uint256, valtype>>& data);
 
 };
 
+void
+NameHashIndex::DB::ReadPreimages (std::vector<uint256> hashes,
+                                  std::map<uint256, valtype>& names)
+{
+  /* The keys are ordered by the raw bytes of the hash, which matches the
+     ordering of uint256.  By looking up the hashes in sorted order with
+     a single iterator, we only need to seek when the iterator is not
+     already at or past the next hash.  */
+  std::sort (hashes.begin (), hashes.end ());
+  hashes.erase (std::unique (hashes.begin (), hashes.end ()), hashes.end ());
+
+  std::unique_ptr<CDBIterator> iter(NewIterator ());
+  std::pair<char, uint256> key;
+  bool haveKey = false;
+  for (const auto& hash : hashes)
+    {
+      if (!haveKey || key.second < hash)
+        {
+          iter->Seek (std::make_pair (DB_HASH, hash));
+          haveKey = iter->Valid () && iter->GetKey (key)
+                      && key.first == DB_HASH;
+          if (!haveKey)
+            break;
+        }
+
+      if (key.second != hash)
+        continue;
+
+      valtype name;
+      if (iter->GetValue (name))
+        names.emplace (hash, std::move (name));
+    }
+}
+
 bool
 NameHashIndex::DB::WritePreimages (
     const std::vector<std::pair<uint256, valtype>>& data)
@@ -70,6 +113,61 @@ NameHashIndex::WriteBlock (const CBlock& block, const CBlockIndex* pindex)
   return db->WritePreimages (data);
 }
 
+bool
+NameHashIndex::Init ()
+{
+  CBlockLocator locator;
+  if (!db->ReadBestBlock (locator) && !BuildFromNameDB ())
+    return false;
+
+  return BaseIndex::Init ();
+}
+
+bool
+NameHashIndex::BuildFromNameDB ()
+{
+  LOCK (cs_main);
+  const CBlockIndex* tip = m_chainstate->m_chain.Tip ();
+  if (tip == nullptr)
+    return true;
+
+  LogPrintf ("%s: Building index from the name database at height %d\n",
+             GetName (), tip->nHeight);
+
+  std::unique_ptr<CNameIterator> iter(m_chainstate->CoinsTip ().IterateNames ());
+  iter->seek (valtype ());
+
+  size_t count = 0;
+  std::vector<std::pair<uint256, valtype>> data;
+  valtype name;
+  CNameData nameData;
+  while (iter->next (name, nameData))
+    {
+      data.emplace_back (Hash (name), name);
+      ++count;
+
+      if (data.size () >= SNAPSHOT_BATCH_SIZE)
+        {
+          if (!db->WritePreimages (data))
+            return error ("%s: failed to write preimages", __func__);
+          data.clear ();
+        }
+    }
+
+  /* The best block is written together with the last batch, so that the
+     index is only considered built once all names have been written.  */
+  CDBBatch batch(*db);
+  for (const auto& entry : data)
+    batch.Write (std::make_pair (DB_HASH, entry.first), entry.second);
+  db->WriteBestBlock (batch, m_chainstate->m_chain.GetLocator (tip));
+  if (!db->WriteBatch (batch))
+    return error ("%s: failed to write preimages", __func__);
+
+  LogPrintf ("%s: Indexed %d names from the name database\n",
+             GetName (), count);
+  return true;
+}
+
 BaseIndex::DB&
 NameHashIndex::GetDB () const
 {
@@ -82,4 +180,11 @@ NameHashIndex::FindNamePreimage (const uint256& hash, valtype& name) const
   return db->ReadPreimage (hash, name);
 }
 
+void
+NameHashIndex::FindNamePreimages (const std::vector<uint256>& hashes,
+                                  std::map<uint256, valtype>& names) const
+{
+  db->ReadPreimages (hashes, names);
+}
+
 std::unique_ptr<NameHashIndex> g_name_hash_index;
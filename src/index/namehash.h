@@ -9,7 +9,9 @@
 #include <script/script.h>
 #include <uint256.h>
 
+#include <map>
 #include <memory>
+#include <vector>
 
 /** Default value for the -namehashindex argument.  */
 static constexpr bool DEFAULT_NAMEHASHINDEX = false;
@@ -28,6 +30,11 @@ static constexpr int64_t MAX_NAMEHASH_CACHE = 1024;
  * Note that this is "append only".  When rewinding a block that first
  * mentions a name, we do not attempt to remove that name again from the index.
  * There's not really a point in doing so.
+ *
+ * Since names never expire, all names ever registered are also in the
+ * name database.  Thus when the index is built from scratch, it is filled
+ * directly from the current name database rather than by processing every
+ * block since genesis.
  */
 class NameHashIndex : public BaseIndex
 {
@@ -38,8 +45,16 @@ private:
 
   const std::unique_ptr<DB> db;
 
+  /**
+   * Fills a fresh index with all names in the current name database
+   * and marks it as synced to the current tip.
+   */
+  bool BuildFromNameDB ();
+
 protected:
 
+    bool Init () override;
+
     bool WriteBlock (const CBlock& block, const CBlockIndex* pindex) override;
 
     BaseIndex::DB& GetDB () const override;
@@ -65,6 +80,14 @@ public:
      */
     bool FindNamePreimage (const uint256& hash, valtype& name) const;
 
+    /**
+     * Looks up many names by hash at once.  The preimages of all hashes
+     * that are found are added to the result map.  This is much faster
+     * than calling FindNamePreimage for each hash individually.
+     */
+    void FindNamePreimages (const std::vector<uint256>& hashes,
+                            std::map<uint256, valtype>& names) const;
+
 };
 
 /** The global name-hash index.  May be null.  */
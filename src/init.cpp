@@ -18,11 +18,13 @@
 #include <compat/sanity.h>
 #include <deploymentstatus.h>
 #include <fs.h>
+#include <games/blockdata.h>
 #include <hash.h>
 #include <httprpc.h>
 #include <httpserver.h>
 #include <index/blockfilterindex.h>
 #include <index/coinstatsindex.h>
+#include <index/gamemoves.h>
 #include <index/namehash.h>
 #include <index/txindex.h>
 #include <init/common.h>
@@ -30,6 +32,8 @@
 #include <interfaces/node.h>
 #include <mapport.h>
 #include <miner.h>
+#include <names/common.h>
+#include <names/main.h>
 #include <names/encoding.h>
 #include <names/mempool.h>
 #include <net.h>
@@ -44,6 +48,7 @@
 #include <policy/policy.h>
 #include <policy/settings.h>
 #include <protocol.h>
+#include <rpc/auxpow_miner.h>
 #include <rpc/blockchain.h>
 #include <rpc/game.h>
 #include <rpc/register.h>
@@ -71,6 +76,7 @@
 #include <validationinterface.h>
 #include <walletinitinterface.h>
 
+#include <algorithm>
 #include <functional>
 #include <set>
 #include <stdint.h>
@@ -174,6 +180,9 @@ void Interrupt(NodeContext& node)
     if (g_name_hash_index) {
         g_name_hash_index->Interrupt();
     }
+    if (g_game_move_index) {
+        g_game_move_index->Interrupt();
+    }
     if (g_send_updates_worker != nullptr) {
         g_send_updates_worker->interrupt();
     }
@@ -222,6 +231,9 @@ void Shutdown(NodeContext& node)
     if (node.scheduler) node.scheduler->stop();
     if (node.chainman && node.chainman->m_load_block.joinable()) node.chainman->m_load_block.join();
     StopScriptCheckWorkerThreads();
+    StopPowCheckWorkerThreads();
+    StopNameCheckWorkerThreads();
+    AuxpowMiner::get().stopNotifications();
 
     // After the threads that potentially access these pointers have been stopped,
     // destruct and reset all to nullptr.
@@ -264,6 +276,10 @@ void Shutdown(NodeContext& node)
         g_name_hash_index->Stop();
         g_name_hash_index.reset();
     }
+    if (g_game_move_index) {
+        g_game_move_index->Stop();
+        g_game_move_index.reset();
+    }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
     DestroyAllBlockFilterIndexes();
 
@@ -295,6 +311,10 @@ void Shutdown(NodeContext& node)
     }
 #endif
 
+    // The game move index and ZMQ notifications extract game data from blocks
+    // until they are stopped, so only stop the worker threads for it now.
+    StopGameBlockDataWorkerThreads();
+
     node.chain_clients.clear();
     UnregisterAllValidationInterfaces();
     GetMainSignals().UnregisterBackgroundSignalScheduler();
@@ -410,7 +430,7 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s, signet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex(), signetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
-    argsman.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
+    argsman.AddArg("-par=<n>", strprintf("Set the number of script and header proof-of-work verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -434,7 +454,9 @@ void SetupServerArgs(ArgsManager& argsman)
                  " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
                  ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-namehistory", strprintf("Keep track of the full name history (default: %u)", 0), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-nameheightindex", strprintf("Maintain an index of names by their last update height, used by name_scan with maxConf (default: %u)", 0), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-namehashindex", strprintf("Maintain an index of name hashes to preimages (default: %u)", DEFAULT_NAMEHASHINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-gamemoveindex", strprintf("Maintain an index of game moves per block, used by game_sendupdates instead of reading blocks from disk (default: %u)", DEFAULT_GAMEMOVEINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 
     argsman.AddArg("-addnode=<ip>", strprintf("Add a node to connect to and attempt to keep the connection open (see the addnode RPC help for more info). This option can be specified multiple times to add multiple nodes; connections are limited to %u at a time and are counted separately from the -maxconnections limit.", MAX_ADDNODE_CONNECTIONS), ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::CONNECTION);
     argsman.AddArg("-asmap=<file>", strprintf("Specify asn mapping used for bucketing of the peers (default: %s). Relative paths will be prefixed by the net-specific datadir location.", DEFAULT_ASMAP_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -500,12 +522,15 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-zmqpubrawblock=<address>", "Enable publish raw block in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubrawtx=<address>", "Enable publish raw transaction in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubsequence=<address>", "Enable publish hash block and tx sequence in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubauxwork=<address>", "Enable publish new merge-mining and stand-alone mining work in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubhashblockhwm=<n>", strprintf("Set publish hash block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubhashtxhwm=<n>", strprintf("Set publish hash transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubrawblockhwm=<n>", strprintf("Set publish raw block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubrawtxhwm=<n>", strprintf("Set publish raw transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubsequencehwm=<n>", strprintf("Set publish hash sequence message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubauxworkhwm=<n>", strprintf("Set publish mining work outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubgameblocks=<address>", "Enable publication of game data for block attach/detach events in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubgameblocksformat=<format>", "Set the data format (json or cbor) of the game block attach/detach notifications (default: json)", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubgamepending=<address>", "Enable publication of pending game transactions in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-trackgame=<game>", "Enable tracking of the listed game for the SpaceXpanse game interface", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
 #else
@@ -514,12 +539,15 @@ void SetupServerArgs(ArgsManager& argsman)
     hidden_args.emplace_back("-zmqpubrawblock=<address>");
     hidden_args.emplace_back("-zmqpubrawtx=<address>");
     hidden_args.emplace_back("-zmqpubsequence=<n>");
+    hidden_args.emplace_back("-zmqpubauxwork=<address>");
     hidden_args.emplace_back("-zmqpubhashblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubhashtxhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawtxhwm=<n>");
     hidden_args.emplace_back("-zmqpubsequencehwm=<n>");
+    hidden_args.emplace_back("-zmqpubauxworkhwm=<n>");
     hidden_args.emplace_back("-zmqpubgameblocks=<address>");
+    hidden_args.emplace_back("-zmqpubgameblocksformat=<format>");
     hidden_args.emplace_back("-zmqpubgamepending=<address>");
     hidden_args.emplace_back("-trackgame=<game>");
 #endif
@@ -527,6 +555,8 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checklevel=<n>", strprintf("How thorough the block verification of -checkblocks is: %s (0-4, default: %u)", Join(CHECKLEVEL_DOC, ", "), DEFAULT_CHECKLEVEL), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checkblockindex", strprintf("Do a consistency check for the block tree, chainstate, and other validation data structures occasionally. (default: %u, regtest: %u)", defaultChainParams->DefaultConsistencyChecks(), regtestChainParams->DefaultConsistencyChecks()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-checknamedb=<n>", strprintf("Check the name database every <n> blocks, 0 for every block and -1 to disable (default: %d, regtest: %d)", defaultChainParams->DefaultCheckNameDB(), regtestChainParams->DefaultCheckNameDB()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-checknamedbincremental", strprintf("Only check names changed since the previous check with -checknamedb, after one full check (default: %u)", DEFAULT_CHECKNAMEDB_INCREMENTAL), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u, regtest: %u)", defaultChainParams->DefaultConsistencyChecks(), regtestChainParams->DefaultConsistencyChecks()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checkpoints", strprintf("Enable rejection of any forks from the known historical chain until block %s (default: %u)", defaultChainParams->Checkpoints().GetHeight(), DEFAULT_CHECKPOINTS_ENABLED), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-deprecatedrpc=<method>", "Allows deprecated RPC method(s) to be used", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
@@ -583,6 +613,9 @@ void SetupServerArgs(ArgsManager& argsman)
     gArgs.AddArg("-limitnamechains=<n>", strprintf("Limit pending chains of name operations for name_update to <n> (default: %u)", DEFAULT_NAME_CHAIN_LIMIT), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
 
     gArgs.AddArg("-maxgameblockattaches=<n>", strprintf("Sets the maximum number of attach steps sent for a single game_sendupdates request (default: %d)", DEFAULT_MAX_GAME_BLOCK_ATTACHES), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
+    gArgs.AddArg("-sendupdatesthreads=<n>", strprintf("Sets the number of threads used to process game_sendupdates requests (default: %u)", DEFAULT_SENDUPDATES_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
+    gArgs.AddArg("-sendupdatesreadahead=<n>", strprintf("Sets the number of blocks that are read and prepared ahead of publishing for a game_sendupdates request (default: %u)", DEFAULT_SENDUPDATES_READAHEAD), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
+    gArgs.AddArg("-sendupdatesbackpressure", strprintf("Wait for slow game-block ZMQ subscribers during game_sendupdates instead of dropping notifications when their high water mark is reached (default: %u)", DEFAULT_SENDUPDATES_BACKPRESSURE), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
 
 #if HAVE_DECL_FORK
     argsman.AddArg("-daemon", strprintf("Run in the background as a daemon and accept commands (default: %d)", DEFAULT_DAEMON), ArgsManager::ALLOW_BOOL, OptionsCategory::OPTIONS);
@@ -880,6 +913,8 @@ bool AppInitParameterInteraction(const ArgsManager& args)
             return InitError(_("Prune mode is incompatible with -coinstatsindex."));
         if (gArgs.GetBoolArg("-namehashindex", DEFAULT_NAMEHASHINDEX))
             return InitError(_("Prune mode is incompatible with -namehashindex."));
+        if (gArgs.GetBoolArg("-gamemoveindex", DEFAULT_GAMEMOVEINDEX))
+            return InitError(_("Prune mode is incompatible with -gamemoveindex."));
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -1138,6 +1173,11 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     if (script_threads >= 1) {
         g_parallel_script_checks = true;
         StartScriptCheckWorkerThreads(script_threads);
+        // Header proof-of-work checks and extracting the game data from
+        // blocks use the same number of threads
+        StartPowCheckWorkerThreads(script_threads);
+        StartGameBlockDataWorkerThreads(script_threads);
+        StartNameCheckWorkerThreads(script_threads);
     }
 
     assert(!node.scheduler);
@@ -1324,13 +1364,29 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     }
 
 #if ENABLE_ZMQ
-    g_zmq_notification_interface = CZMQNotificationInterface::Create(node.chainman->m_blockman);
+    GameNotificationFormat gameBlocksFormat;
+    if (!ParseGameNotificationFormat(args.GetArg("-zmqpubgameblocksformat", "json"), gameBlocksFormat)) {
+        return InitError(strprintf(_("Invalid -zmqpubgameblocksformat: '%s'"), args.GetArg("-zmqpubgameblocksformat", "")));
+    }
+    g_zmq_notification_interface = CZMQNotificationInterface::Create(gameBlocksFormat);
 
     if (g_zmq_notification_interface) {
         RegisterValidationInterface(g_zmq_notification_interface);
+
+        // Only listen for mining work if it is published at all, since
+        // the auxpow miner builds templates for every tip while there are
+        // listeners.
+        const auto notifiers = g_zmq_notification_interface->GetActiveNotifiers();
+        if (std::any_of(notifiers.begin(), notifiers.end(), [](const CZMQAbstractNotifier* n) { return n->GetType() == "pubauxwork"; })) {
+            AuxpowMiner::get().addWorkListener([](const UniValue& work) {
+                g_zmq_notification_interface->NotifyAuxWork(work);
+            });
+        }
     }
 #endif
 
+    AuxpowMiner::get().startNotifications(*node.chainman, *node.mempool);
+
     // ********************************************************* Step 7: load block chain
 
     fReindex = args.GetBoolArg("-reindex", false);
@@ -1346,6 +1402,8 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     nTotalCache -= nTxIndexCache;
     const int64_t nNameHashIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-namehashindex", DEFAULT_NAMEHASHINDEX) ? MAX_NAMEHASH_CACHE << 20 : 0);
     nTotalCache -= nNameHashIndexCache;
+    const int64_t nGameMoveIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-gamemoveindex", DEFAULT_GAMEMOVEINDEX) ? MAX_GAMEMOVE_CACHE << 20 : 0);
+    nTotalCache -= nGameMoveIndexCache;
     int64_t filter_index_cache = 0;
     if (!g_enabled_filter_types.empty()) {
         size_t n_indexes = g_enabled_filter_types.size();
@@ -1366,6 +1424,9 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     if (gArgs.GetBoolArg("-namehashindex", DEFAULT_NAMEHASHINDEX)) {
         LogPrintf("* Using %.1f MiB for name hash database\n", nNameHashIndexCache * (1.0 / 1024 / 1024));
     }
+    if (gArgs.GetBoolArg("-gamemoveindex", DEFAULT_GAMEMOVEINDEX)) {
+        LogPrintf("* Using %.1f MiB for game move database\n", nGameMoveIndexCache * (1.0 / 1024 / 1024));
+    }
     for (BlockFilterType filter_type : g_enabled_filter_types) {
         LogPrintf("* Using %.1f MiB for %s block filter index database\n",
                   filter_index_cache * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
@@ -1463,6 +1524,9 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
                             "", CClientUIInterface::MSG_ERROR);
                     });
 
+                    // Changed names are only needed for incremental checks with -checknamedb.
+                    chainstate->CoinsDB().SetCollectNamesToCheck(args.GetArg("-checknamedb", chainparams.DefaultCheckNameDB()) != -1);
+
                     // If necessary, upgrade from older database format.
                     // This is a no-op if we cleared the coinsviewdb with -reindex or -reindex-chainstate
                     if (!chainstate->CoinsDB().Upgrade()) {
@@ -1471,6 +1535,14 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
                         break;
                     }
 
+                    // Build or remove the name height index as requested.
+                    fNameHeightIndex = gArgs.GetBoolArg("-nameheightindex", false);
+                    if (!chainstate->CoinsDB().SyncNameHeightIndex()) {
+                        strLoadError = _("Error building the name height index");
+                        failed_chainstate_init = true;
+                        break;
+                    }
+
                     // ReplayBlocks is a no-op if we cleared the coinsviewdb with -reindex or -reindex-chainstate
                     if (!chainstate->ReplayBlocks()) {
                         strLoadError = _("Unable to replay blocks. You will need to rebuild the database using -reindex-chainstate.");
@@ -1602,6 +1674,13 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         }
     }
 
+    if (gArgs.GetBoolArg("-gamemoveindex", DEFAULT_GAMEMOVEINDEX)) {
+        g_game_move_index = std::make_unique<GameMoveIndex>(nGameMoveIndexCache, false, fReindex);
+        if (!g_game_move_index->Start(chainman.ActiveChainstate())) {
+            return false;
+        }
+    }
+
     for (const auto& filter_type : g_enabled_filter_types) {
         InitBlockFilterIndex(filter_type, filter_index_cache, false, fReindex);
         if (!GetBlockFilterIndex(filter_type)->Start(chainman.ActiveChainstate())) {
@@ -1833,7 +1912,10 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     }
 
     assert (g_send_updates_worker == nullptr);
-    g_send_updates_worker.reset(new SendUpdatesWorker ());
+    g_send_updates_worker.reset(new SendUpdatesWorker (
+        std::max<int64_t>(1, args.GetArg("-sendupdatesthreads", DEFAULT_SENDUPDATES_THREADS)),
+        std::max<int64_t>(1, args.GetArg("-sendupdatesreadahead", DEFAULT_SENDUPDATES_READAHEAD)),
+        args.GetBoolArg("-sendupdatesbackpressure", DEFAULT_SENDUPDATES_BACKPRESSURE)));
 
     // ********************************************************* Step 13: finished
 
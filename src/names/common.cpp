@@ -4,9 +4,16 @@
 
 #include <names/common.h>
 
+#include <crypto/siphash.h>
+#include <random.h>
 #include <script/names.h>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 bool fNameHistory = false;
+bool fNameHeightIndex = false;
 
 /* ************************************************************************** */
 /* CNameData.  */
@@ -31,6 +38,48 @@ CNameIterator::~CNameIterator ()
      subclasses if they need a destructor.  */
 }
 
+/* ************************************************************************** */
+/* CPrefixNameIterator.  */
+
+CPrefixNameIterator::CPrefixNameIterator (CNameIterator* b, const valtype& p)
+  : base(b), prefix(p)
+{}
+
+void
+CPrefixNameIterator::seek (const valtype& start)
+{
+  base->seek (start);
+}
+
+bool
+CPrefixNameIterator::next (valtype& name, CNameData& data)
+{
+  while (base->next (name, data))
+    {
+      if (name.size () < prefix.size ())
+        {
+          /* The first candidate is the prefix itself.  */
+          base->seek (prefix);
+          continue;
+        }
+
+      const int cmp = std::memcmp (name.data (), prefix.data (),
+                                   prefix.size ());
+      if (cmp == 0)
+        return true;
+
+      /* Seek to the smallest name starting with the prefix that is larger
+         than the current one.  If the current name is before the matching
+         range for its length, this is at the same length.  Otherwise we
+         have reached the upper bound and continue with the next length.  */
+      valtype target = prefix;
+      target.resize (cmp < 0 ? name.size () : name.size () + 1, 0);
+      base->seek (target);
+    }
+
+  return false;
+}
+
 /* ************************************************************************** */
 /* CNameCacheNameIterator.  */
 
@@ -52,8 +101,17 @@ private:
   /** "Next" data of the base iterator.  */
   CNameData baseData;
 
-  /** Iterator of the cache's entries.  */
-  CNameCache::EntryMap::const_iterator cacheIter;
+  /** The cache's entries in database order.  */
+  const std::vector<const CNameCache::EntryMap::value_type*>* cacheEntries;
+  /** Position of the next cache entry in cacheEntries.  */
+  size_t cachePos;
+
+  /* Return true if there are more entries from the cache.  */
+  inline bool
+  cacheHasMore () const
+  {
+    return cachePos < cacheEntries->size ();
+  }
 
   /* Call the base iterator's next() routine to fill in the internal
      "cache" for the next entry.  This already skips entries that are
@@ -104,7 +162,16 @@ CCacheNameIterator::advanceBaseIterator ()
 void
 CCacheNameIterator::seek (const valtype& start)
 {
-  cacheIter = cache.entries.lower_bound (start);
+  cacheEntries = &cache.getSortedEntries ();
+  const CNameCache::NameComparator cmp;
+  const auto it = std::lower_bound (cacheEntries->begin (),
+                                    cacheEntries->end (), start,
+                                    [&cmp] (const auto* entry,
+                                            const valtype& name)
+                                      {
+                                        return cmp (entry->first, name);
+                                      });
+  cachePos = it - cacheEntries->begin ();
   base->seek (start);
 
   baseHasMore = true;
@@ -116,21 +183,21 @@ CCacheNameIterator::next (valtype& name, CNameData& data)
 {
   /* Exit early if no more data is available in either the cache
      nor the base iterator.  */
-  if (!baseHasMore && cacheIter == cache.entries.end ())
+  if (!baseHasMore && !cacheHasMore ())
     return false;
 
   /* Determine which source to use for the next.  */
   bool useBase;
   if (!baseHasMore)
     useBase = false;
-  else if (cacheIter == cache.entries.end ())
+  else if (!cacheHasMore ())
     useBase = true;
   else
     {
       /* A special case is when both iterators are equal.  In this case,
          we want to use the cached version.  We also have to advance
          the base iterator.  */
-      if (baseName == cacheIter->first)
+      if (baseName == (*cacheEntries)[cachePos]->first)
         advanceBaseIterator ();
 
       /* Due to advancing the base iterator above, it may happen that
@@ -139,10 +206,11 @@ CCacheNameIterator::next (valtype& name, CNameData& data)
         useBase = false;
       else
         {
-          assert (baseName != cacheIter->first);
+          const valtype& cacheName = (*cacheEntries)[cachePos]->first;
+          assert (baseName != cacheName);
 
           CNameCache::NameComparator cmp;
-          useBase = cmp (baseName, cacheIter->first);
+          useBase = cmp (baseName, cacheName);
         }
     }
 
@@ -155,9 +223,10 @@ CCacheNameIterator::next (valtype& name, CNameData& data)
     }
   else
     {
-      name = cacheIter->first;
-      data = cacheIter->second;
-      ++cacheIter;
+      const auto* entry = (*cacheEntries)[cachePos];
+      name = entry->first;
+      data = entry->second;
+      ++cachePos;
     }
 
   return true;
@@ -166,6 +235,49 @@ CCacheNameIterator::next (valtype& name, CNameData& data)
 /* ************************************************************************** */
 /* CNameCache.  */
 
+CNameCache::NameHasher::NameHasher ()
+  : k0(GetRand (std::numeric_limits<uint64_t>::max ())),
+    k1(GetRand (std::numeric_limits<uint64_t>::max ()))
+{}
+
+size_t
+CNameCache::NameHasher::operator() (const valtype& name) const
+{
+  return CSipHasher (k0, k1).Write (name.data (), name.size ()).Finalize ();
+}
+
+const std::vector<const CNameCache::EntryMap::value_type*>&
+CNameCache::getSortedEntries () const
+{
+  if (!sortedValid)
+    {
+      sortedEntries.clear ();
+      sortedEntries.reserve (entries.size ());
+      for (const auto& entry : entries)
+        sortedEntries.push_back (&entry);
+
+      const NameComparator cmp;
+      std::sort (sortedEntries.begin (), sortedEntries.end (),
+                 [&cmp] (const auto* a, const auto* b)
+                   {
+                     return cmp (a->first, b->first);
+                   });
+      sortedValid = true;
+    }
+
+  return sortedEntries;
+}
+
+size_t
+CNameCache::DynamicMemoryUsage () const
+{
+  return cachedUsage
+          + memusage::MallocUsage (sizeof (void*) * entries.bucket_count ())
+          + memusage::MallocUsage (sizeof (void*) * deleted.bucket_count ())
+          + memusage::MallocUsage (sizeof (void*) * history.bucket_count ())
+          + memusage::DynamicUsage (sortedEntries);
+}
+
 bool
 CNameCache::get (const valtype& name, CNameData& data) const
 {
@@ -180,15 +292,30 @@ CNameCache::get (const valtype& name, CNameData& data) const
 void
 CNameCache::set (const valtype& name, const CNameData& data)
 {
-  const std::set<valtype>::iterator di = deleted.find (name);
+  const auto di = deleted.find (name);
   if (di != deleted.end ())
-    deleted.erase (di);
+    {
+      cachedUsage -= memusage::IncrementalDynamicUsage (deleted)
+                      + memusage::DynamicUsage (*di);
+      deleted.erase (di);
+    }
 
-  const EntryMap::iterator ei = entries.find (name);
+  /* The usage of the stored copy is what counts, since assigning a shorter
+     value keeps the larger capacity of the existing one.  */
+  EntryMap::iterator ei = entries.find (name);
   if (ei != entries.end ())
-    ei->second = data;
+    {
+      cachedUsage -= ei->second.DynamicMemoryUsage ();
+      ei->second = data;
+    }
   else
-    entries.insert (std::make_pair (name, data));
+    {
+      cachedUsage += memusage::IncrementalDynamicUsage (entries)
+                      + memusage::DynamicUsage (name);
+      ei = entries.emplace (name, data).first;
+      sortedValid = false;
+    }
+  cachedUsage += ei->second.DynamicMemoryUsage ();
 }
 
 void
@@ -196,9 +323,17 @@ CNameCache::remove (const valtype& name)
 {
   const EntryMap::iterator ei = entries.find (name);
   if (ei != entries.end ())
-    entries.erase (ei);
+    {
+      cachedUsage -= memusage::IncrementalDynamicUsage (entries)
+                      + memusage::DynamicUsage (ei->first)
+                      + ei->second.DynamicMemoryUsage ();
+      entries.erase (ei);
+      sortedValid = false;
+    }
 
-  deleted.insert (name);
+  if (deleted.insert (name).second)
+    cachedUsage += memusage::IncrementalDynamicUsage (deleted)
+                    + memusage::DynamicUsage (name);
 }
 
 CNameIterator*
@@ -207,43 +342,246 @@ CNameCache::iterateNames (CNameIterator* base) const
   return new CCacheNameIterator (*this, base);
 }
 
-bool
-CNameCache::getHistory (const valtype& name, CNameHistory& res) const
+CNameCache::HistoryChanges&
+CNameCache::getHistoryChanges (const valtype& name)
+{
+  auto mit = history.find (name);
+  if (mit == history.end ())
+    {
+      cachedUsage += memusage::IncrementalDynamicUsage (history)
+                      + memusage::DynamicUsage (name);
+      mit = history.emplace (name, HistoryChanges ()).first;
+    }
+
+  return mit->second;
+}
+
+void
+CNameCache::addHistoryEntry (HistoryChanges& changes, const HistoryKey& key,
+                             const CNameData& entry)
+{
+  if (changes.removed.erase (key) > 0)
+    cachedUsage -= memusage::IncrementalDynamicUsage (changes.removed);
+
+  auto it = changes.added.find (key);
+  if (it != changes.added.end ())
+    {
+      cachedUsage -= it->second.DynamicMemoryUsage ();
+      it->second = entry;
+    }
+  else
+    {
+      cachedUsage += memusage::IncrementalDynamicUsage (changes.added);
+      it = changes.added.emplace (key, entry).first;
+    }
+  cachedUsage += it->second.DynamicMemoryUsage ();
+}
+
+void
+CNameCache::removeHistoryEntry (HistoryChanges& changes, const HistoryKey& key)
+{
+  const auto it = changes.added.find (key);
+  if (it != changes.added.end ())
+    {
+      cachedUsage -= memusage::IncrementalDynamicUsage (changes.added)
+                      + it->second.DynamicMemoryUsage ();
+      changes.added.erase (it);
+    }
+
+  if (changes.removed.insert (key).second)
+    cachedUsage += memusage::IncrementalDynamicUsage (changes.removed);
+}
+
+void
+CNameCache::addHistory (const valtype& name, const HistoryKey& key,
+                        const CNameData& entry)
 {
   assert (fNameHistory);
+  assert (key.first == entry.getHeight ());
+  addHistoryEntry (getHistoryChanges (name), key, entry);
+}
 
-  const std::map<valtype, CNameHistory>::const_iterator i = history.find (name);
-  if (i == history.end ())
-    return false;
+void
+CNameCache::removeHistory (const valtype& name, const HistoryKey& key)
+{
+  assert (fNameHistory);
 
-  res = i->second;
-  return true;
+  /* Even if the entry was added in this cache, we still have to mark it
+     as removed:  It may have been in the base view before, removed and
+     added back in this cache.  Erasing a non-existing key from the
+     database is harmless.  */
+  removeHistoryEntry (getHistoryChanges (name), key);
+}
+
+size_t
+CNameCache::getHistoryOverlap (const valtype& name) const
+{
+  assert (fNameHistory);
+
+  const auto mit = history.find (name);
+  if (mit == history.end ())
+    return 0;
+
+  return mit->second.added.size () + mit->second.removed.size ();
 }
 
 void
-CNameCache::setHistory (const valtype& name, const CNameHistory& data)
+CNameCache::mergeHistory (const valtype& name, const HistoryKey& start,
+                          const size_t maxCount, CNameHistory& data) const
 {
   assert (fNameHistory);
 
-  const std::map<valtype, CNameHistory>::iterator ei = history.find (name);
-  if (ei != history.end ())
-    ei->second = data;
-  else
-    history.insert (std::make_pair (name, data));
+  const auto mit = history.find (name);
+  if (mit == history.end ())
+    {
+      data.truncate (maxCount);
+      return;
+    }
+  const HistoryChanges& changes = mit->second;
+
+  CNameHistory merged;
+  auto addIt = changes.added.lower_bound (start);
+  const auto& entries = data.getData ();
+  const auto& keys = data.getKeys ();
+  for (size_t i = 0; i < entries.size (); ++i)
+    {
+      const HistoryKey& key = keys[i];
+      if (changes.removed.count (key) > 0)
+        continue;
+
+      for (; addIt != changes.added.end () && addIt->first < key; ++addIt)
+        merged.push (addIt->first, addIt->second);
+
+      /* If the entry is also in the added set, the cached version takes
+         precedence.  It will be added in the loop above next time
+         or after the main loop.  */
+      if (addIt != changes.added.end () && addIt->first == key)
+        continue;
+
+      merged.push (key, entries[i]);
+    }
+  for (; addIt != changes.added.end (); ++addIt)
+    merged.push (addIt->first, addIt->second);
+
+  merged.truncate (maxCount);
+  data = std::move (merged);
+}
+
+void
+CNameCache::setHeightIndex (const unsigned height, const valtype& name,
+                            const bool present)
+{
+  assert (fNameHeightIndex);
+
+  auto key = std::make_pair (height, name);
+  const auto it = heightIndex.find (key);
+  if (it != heightIndex.end ())
+    {
+      it->second = present;
+      return;
+    }
+
+  cachedUsage += memusage::IncrementalDynamicUsage (heightIndex)
+                  + memusage::DynamicUsage (name);
+  heightIndex.emplace (std::move (key), present);
+}
+
+void
+CNameCache::mergeHeightIndex (const unsigned minHeight,
+                              const unsigned maxHeight, NameSet& names) const
+{
+  assert (fNameHeightIndex);
+
+  /* A name may have been moved from one height to another in the cache.
+     Thus process all removals first, so that they do not undo additions
+     of the same name at a lower height.  */
+  const auto begin = heightIndex.lower_bound (
+      std::make_pair (minHeight, valtype ()));
+  for (const bool present : {false, true})
+    for (auto it = begin; it != heightIndex.end (); ++it)
+      {
+        if (it->first.first > maxHeight)
+          break;
+        if (it->second == present)
+          {
+            if (present)
+              names.insert (it->first.second);
+            else
+              names.erase (it->first.second);
+          }
+      }
 }
 
 void
 CNameCache::apply (const CNameCache& cache)
 {
-  for (EntryMap::const_iterator i = cache.entries.begin ();
-       i != cache.entries.end (); ++i)
-    set (i->first, i->second);
+  for (const auto& entry : cache.entries)
+    set (entry.first, entry.second);
+
+  for (const auto& name : cache.deleted)
+    remove (name);
+
+  for (const auto& entry : cache.history)
+    {
+      HistoryChanges& changes = getHistoryChanges (entry.first);
+      for (const auto& key : entry.second.removed)
+        removeHistoryEntry (changes, key);
+      for (const auto& added : entry.second.added)
+        addHistoryEntry (changes, added.first, added.second);
+    }
+
+  for (const auto& entry : cache.heightIndex)
+    {
+      const auto it = heightIndex.find (entry.first);
+      if (it != heightIndex.end ())
+        it->second = entry.second;
+      else
+        {
+          cachedUsage += memusage::IncrementalDynamicUsage (heightIndex)
+                          + memusage::DynamicUsage (entry.first.second);
+          heightIndex.insert (entry);
+        }
+    }
+}
+
+void
+CNameCache::collectChangedNames (NameSet& names) const
+{
+  for (const auto& entry : entries)
+    names.insert (entry.first);
+  for (const auto& name : deleted)
+    names.insert (name);
+  for (const auto& entry : history)
+    names.insert (entry.first);
+}
+
+size_t
+CNameCache::ComputeMemoryUsage () const
+{
+  size_t res = memusage::DynamicUsage (entries);
+  for (const auto& entry : entries)
+    res += memusage::DynamicUsage (entry.first)
+            + entry.second.DynamicMemoryUsage ();
+
+  res += memusage::DynamicUsage (deleted);
+  for (const auto& name : deleted)
+    res += memusage::DynamicUsage (name);
+
+  res += memusage::DynamicUsage (history);
+  for (const auto& entry : history)
+    {
+      res += memusage::DynamicUsage (entry.first);
+      res += memusage::DynamicUsage (entry.second.added);
+      for (const auto& added : entry.second.added)
+        res += added.second.DynamicMemoryUsage ();
+      res += memusage::DynamicUsage (entry.second.removed);
+    }
+
+  res += memusage::DynamicUsage (heightIndex);
+  for (const auto& entry : heightIndex)
+    res += memusage::DynamicUsage (entry.first.second);
 
-  for (std::set<valtype>::const_iterator i = cache.deleted.begin ();
-       i != cache.deleted.end (); ++i)
-    remove (*i);
+  res += memusage::DynamicUsage (sortedEntries);
 
-  for (std::map<valtype, CNameHistory>::const_iterator i
-        = cache.history.begin (); i != cache.history.end (); ++i)
-    setHistory (i->first, i->second);
+  return res;
 }
@@ -6,18 +6,26 @@
 #define H_BITCOIN_NAMES_COMMON
 
 #include <compat/endian.h>
+#include <memusage.h>
 #include <primitives/transaction.h>
 #include <script/script.h>
 #include <serialize.h>
 
 #include <map>
+#include <memory>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 class CNameScript;
 class CDBBatch;
 
 /** Whether or not name history is enabled.  */
 extern bool fNameHistory;
+/** Whether or not the index of names by update height is enabled.  */
+extern bool fNameHeightIndex;
 
 /* ************************************************************************** */
 /* CNameData.  */
@@ -105,6 +113,16 @@ public:
     return addr;
   }
 
+  /**
+   * Return the dynamically allocated memory used by this object.
+   * @return The dynamic memory usage in bytes.
+   */
+  inline size_t
+  DynamicMemoryUsage () const
+  {
+    return memusage::DynamicUsage (value) + memusage::DynamicUsage (addr);
+  }
+
   /**
    * Set from a name update operation.
    * @param h The height (not available from script).
@@ -119,28 +137,38 @@ public:
 /* CNameHistory.  */
 
 /**
- * Keep track of a name's history.  This is a stack of old CNameData
- * objects that have been obsoleted.
+ * Keep track of a name's history.  This is a list of old CNameData
+ * objects that have been obsoleted, ordered by their history key.
+ *
+ * The history key of an entry is its height together with its index among
+ * the name's entries at that height.  Multiple updates of a name within
+ * one block get increasing indices in the order in which they were made,
+ * so that the history is chronological also within a block.  In the
+ * database, each entry is stored individually keyed by the name and its
+ * history key.  This class is used to hold (a range of) those entries
+ * in memory.
  */
 class CNameHistory
 {
 
+public:
+
+  /** Key of a history entry:  Its height and index at that height.  */
+  typedef std::pair<unsigned, uint32_t> Key;
+
 private:
 
   /** The actual data.  */
   std::vector<CNameData> data;
 
-public:
+  /** The history keys of the entries in data.  */
+  std::vector<Key> keys;
 
-  SERIALIZE_METHODS (CNameHistory, obj)
-  {
-    READWRITE (obj.data);
-  }
+public:
 
   /**
-   * Check if the stack is empty.  This is used to decide when to fully
-   * delete an entry in the database.
-   * @return True iff the data stack is empty.
+   * Check if the list is empty.
+   * @return True iff the data list is empty.
    */
   inline bool
   empty () const
@@ -150,7 +178,7 @@ public:
 
   /**
    * Access the data in a read-only way.
-   * @return The data stack.
+   * @return The data list.
    */
   inline const std::vector<CNameData>&
   getData () const
@@ -159,28 +187,42 @@ public:
   }
 
   /**
-   * Push a new entry onto the data stack.  The new entry's height should
-   * be at least as high as the stack top entry's.  If not, fail.
-   * @param entry The new entry to push onto the stack.
+   * Access the history keys of the entries in getData.
+   * @return The list of keys.
+   */
+  inline const std::vector<Key>&
+  getKeys () const
+  {
+    return keys;
+  }
+
+  /**
+   * Push a new entry onto the end of the list.  The new entry's key should
+   * be larger than the last entry's.  If not, fail.
+   * @param key The history key of the new entry.
+   * @param entry The new entry to add.
    */
   inline void
-  push (const CNameData& entry)
+  push (const Key& key, const CNameData& entry)
   {
-    assert (data.empty () || data.back ().getHeight () <= entry.getHeight ());
+    assert (key.first == entry.getHeight ());
+    assert (keys.empty () || keys.back () < key);
+    keys.push_back (key);
     data.push_back (entry);
   }
 
   /**
-   * Pop the top entry off the stack.  This is used when undoing name
-   * changes.  The name's new value is passed as argument and should
-   * match the removed entry.  If not, fail.
-   * @param entry The name's value after undoing.
+   * Remove entries from the end so that at most n remain.
+   * @param n The maximum number of entries to keep.
    */
   inline void
-  pop (const CNameData& entry)
+  truncate (const size_t n)
   {
-    assert (!data.empty () && data.back () == entry);
-    data.pop_back ();
+    if (data.size () > n)
+      {
+        data.resize (n);
+        keys.resize (n);
+      }
   }
 
 };
@@ -212,6 +254,41 @@ public:
 
 };
 
+/**
+ * Name iterator that only returns names with a given prefix from some
+ * base iterator.  Since names are ordered by length first, the names
+ * with a given prefix are not contiguous.  But for each length, they
+ * are; this iterator seeks the base iterator directly to the start of
+ * the matching range of each length, and to the next length as soon as
+ * it reaches the prefix's upper bound.  Thus it never reads more than
+ * two non-matching names per name length.
+ */
+class CPrefixNameIterator : public CNameIterator
+{
+
+private:
+
+  /** The base iterator.  */
+  std::unique_ptr<CNameIterator> base;
+
+  /** The prefix to filter for.  */
+  const valtype prefix;
+
+public:
+
+  /**
+   * Construct the iterator.  This takes ownership of the base iterator.
+   * @param b The base iterator.
+   * @param p The prefix to filter for.
+   */
+  CPrefixNameIterator (CNameIterator* b, const valtype& p);
+
+  /* Implement iterator methods.  */
+  void seek (const valtype& name) override;
+  bool next (valtype& name, CNameData& data) override;
+
+};
+
 /* ************************************************************************** */
 /* CNameCache.  */
 
@@ -223,12 +300,11 @@ public:
 class CNameCache
 {
 
-private:
+public:
 
   /**
    * Special comparator class for names that compares by length first.
-   * This is used to sort the cache entry map in the same way as the
-   * database is sorted.
+   * This is used to sort names in the same way as the database is sorted.
    */
   class NameComparator
   {
@@ -243,29 +319,99 @@ private:
     }
   };
 
-public:
-
   /**
-   * Type of name entry map.  This is public because it is also used
-   * by the unit tests.
+   * Salted hasher for names.  Names are chosen by users, so the salt
+   * prevents them from constructing collisions in the hash maps.
    */
-  typedef std::map<valtype, CNameData, NameComparator> EntryMap;
+  class NameHasher
+  {
+  private:
+    /** Salt for SipHash.  */
+    uint64_t k0, k1;
+  public:
+    NameHasher ();
+    size_t operator() (const valtype& name) const;
+  };
+
+  /** Type of name entry map.  */
+  typedef std::unordered_map<valtype, CNameData, NameHasher> EntryMap;
+
+  /** Set of names, ordered in the same way as the database.  */
+  typedef std::set<valtype, NameComparator> NameSet;
 
 private:
 
   /** New or updated names.  */
   EntryMap entries;
   /** Deleted names.  */
-  std::set<valtype> deleted;
+  std::unordered_set<valtype, NameHasher> deleted;
 
   /**
-   * New or updated history stacks.  If they are empty, the corresponding
-   * database entry is deleted instead.
+   * Pointers to the elements of entries, sorted in the same way as the
+   * database.  This is only needed when iterating names and built lazily
+   * by getSortedEntries.  References to elements of an unordered map
+   * stay valid until they are erased, so this only needs to be rebuilt
+   * when names are added to or removed from entries.
    */
-  std::map<valtype, CNameHistory> history;
+  mutable std::vector<const EntryMap::value_type*> sortedEntries;
+  /** Whether sortedEntries is up-to-date with entries.  */
+  mutable bool sortedValid = true;
+
+  /** Type used for keys of individual history entries.  */
+  typedef CNameHistory::Key HistoryKey;
+
+  /**
+   * Changes to the history entries of a single name.  A key is never
+   * in both added and removed at the same time.
+   */
+  struct HistoryChanges
+  {
+    /** History entries that are added.  */
+    std::map<HistoryKey, CNameData> added;
+    /** History entries that are removed.  */
+    std::set<HistoryKey> removed;
+  };
+
+  /** Changes to the name history, by name.  */
+  std::unordered_map<valtype, HistoryChanges, NameHasher> history;
+
+  /**
+   * Changes to the index of names by update height.  The value is true
+   * if the index entry is added and false if it is removed.
+   */
+  std::map<std::pair<unsigned, valtype>, bool> heightIndex;
+
+  /**
+   * Dynamic memory used by all the elements of the maps and sets above,
+   * including the names and data stored in them.  This is kept up-to-date
+   * by all modifying operations, so that it can be queried cheaply.
+   * The bucket arrays of the hash maps and sortedEntries are not
+   * included, they are added in DynamicMemoryUsage.
+   */
+  size_t cachedUsage = 0;
 
   friend class CCacheNameIterator;
 
+  /**
+   * Return the elements of entries sorted in the same way as the database.
+   * The result is invalidated when names are added to or removed from
+   * the cache.
+   */
+  const std::vector<const EntryMap::value_type*>& getSortedEntries () const;
+
+  /**
+   * Return the history changes for the given name, creating an empty
+   * entry if there is none yet.
+   */
+  HistoryChanges& getHistoryChanges (const valtype& name);
+
+  /** Mark the given history entry as added.  */
+  void addHistoryEntry (HistoryChanges& changes, const HistoryKey& key,
+                        const CNameData& entry);
+
+  /** Mark the given history entry as removed.  */
+  void removeHistoryEntry (HistoryChanges& changes, const HistoryKey& key);
+
 public:
 
   inline void
@@ -273,9 +419,28 @@ public:
   {
     entries.clear ();
     deleted.clear ();
+    sortedEntries.clear ();
+    sortedValid = true;
     history.clear ();
+    heightIndex.clear ();
+    cachedUsage = 0;
   }
 
+  /**
+   * Return the dynamic memory used by the cached changes.  This is tracked
+   * incrementally and thus cheap to call.
+   * @return The dynamic memory usage in bytes.
+   */
+  size_t DynamicMemoryUsage () const;
+
+  /**
+   * Compute the dynamic memory usage from scratch by walking all the
+   * cached changes.  This is used to verify the incrementally tracked
+   * value in tests.
+   * @return The dynamic memory usage in bytes.
+   */
+  size_t ComputeMemoryUsage () const;
+
   /**
    * Check if the cache is "clean" (no cached changes).  This also
    * performs internal checks and fails with an assertion if the
@@ -287,7 +452,7 @@ public:
   {
     if (entries.empty () && deleted.empty ())
       {
-        assert (history.empty ());
+        assert (history.empty () && heightIndex.empty ());
         return true;
       }
 
@@ -318,19 +483,66 @@ public:
   CNameIterator* iterateNames (CNameIterator* base) const;
 
   /**
-   * Query for an history entry.
-   * @param name The name to look up.
-   * @param res Put the resulting history entry here.
-   * @return True iff the name was found in the cache.
+   * Add a new entry to a name's history.
+   * @param name The name to modify.
+   * @param key The history key of the new entry.
+   * @param entry The history entry to add.
    */
-  bool getHistory (const valtype& name, CNameHistory& res) const;
+  void addHistory (const valtype& name, const HistoryKey& key,
+                   const CNameData& entry);
 
   /**
-   * Set a name history entry.
+   * Remove an entry from a name's history.
    * @param name The name to modify.
-   * @param data The new history entry.
+   * @param key The history key of the entry to remove.
+   */
+  void removeHistory (const valtype& name, const HistoryKey& key);
+
+  /**
+   * Returns how many entries of the base view's history for the given
+   * name may be hidden or replaced by the changes in this cache.  A range
+   * query against the base view needs to fetch that many entries in
+   * addition to the requested count for the merged result to be complete.
+   * @param name The name to look up.
+   * @return Number of extra entries to fetch from the base.
+   */
+  size_t getHistoryOverlap (const valtype& name) const;
+
+  /**
+   * Merge the cached changes to a name's history into a range of history
+   * entries that has been read from the base view.
+   * @param name The name being queried.
+   * @param start Only return entries with at least this history key.
+   * @param maxCount Return at most this many entries.
+   * @param data The base entries on input, the merged result on output.
+   */
+  void mergeHistory (const valtype& name, const HistoryKey& start,
+                     size_t maxCount, CNameHistory& data) const;
+
+  /**
+   * Add or remove an entry of the index by update height.
+   * @param height The update height of the entry.
+   * @param name The name of the entry.
+   * @param present True to add the entry, false to remove it.
+   */
+  void setHeightIndex (unsigned height, const valtype& name, bool present);
+
+  /**
+   * Merge the cached changes to the height index into a set of names
+   * that have been read from the base view for the given height range.
+   * @param minHeight Minimum height (inclusive) of the range.
+   * @param maxHeight Maximum height (inclusive) of the range.
+   * @param names The base names on input, the merged result on output.
+   */
+  void mergeHeightIndex (unsigned minHeight, unsigned maxHeight,
+                         NameSet& names) const;
+
+  /**
+   * Add all names that are changed by this cache (updated or deleted names
+   * and names with history changes) to the given set.
+   * @param names Add the changed names here.
    */
-  void setHistory (const valtype& name, const CNameHistory& data);
+  void collectChangedNames (NameSet& names) const;
 
   /* Apply all the changes in the passed-in record on top of this one.  */
   void apply (const CNameCache& cache);
@@ -326,7 +326,11 @@ CheckNameDB (CChainState& chainState, bool disconnect)
         return;
     }
 
+  const bool incremental
+    = gArgs.GetBoolArg ("-checknamedbincremental",
+                        DEFAULT_CHECKNAMEDB_INCREMENTAL);
+
   auto& coinsTip = chainState.CoinsTip ();
   coinsTip.Flush ();
-  assert (coinsTip.ValidateNameDB (chainState, [] () {}));
+  assert (coinsTip.ValidateNameDB (chainState, incremental, [] () {}));
 }
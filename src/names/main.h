@@ -22,6 +22,9 @@ class TxValidationState;
 /** The amount of coins to lock in created transactions.  */
 constexpr CAmount NAME_LOCKED_AMOUNT = COIN / 100;
 
+/** Default for -checknamedbincremental.  */
+constexpr bool DEFAULT_CHECKNAMEDB_INCREMENTAL = false;
+
 /* ************************************************************************** */
 /* CNameTxUndo.  */
 
@@ -109,8 +112,9 @@ void ApplyNameTransaction (const CTransaction& tx, unsigned nHeight,
 
 /**
  * Check the name database consistency.  This calls CCoinsView::ValidateNameDB,
- * but only if applicable depending on the -checknamedb setting.  If it fails,
- * this throws an assertion failure.
+ * but only if applicable depending on the -checknamedb setting.  With
+ * -checknamedbincremental, only names changed since the last check are
+ * validated.  If it fails, this throws an assertion failure.
  * @param disconnect Whether we are disconnecting blocks.
  */
 void CheckNameDB (CChainState& chainState, bool disconnect);
@@ -5,100 +5,172 @@
 #include <names/mempool.h>
 
 #include <coins.h>
+#include <games/blockdata.h>
 #include <logging.h>
+#include <memusage.h>
 #include <names/encoding.h>
 #include <script/names.h>
 #include <txmempool.h>
 #include <util/strencodings.h>
 #include <validation.h>
 
+#include <algorithm>
+#include <iterator>
+
 /* ************************************************************************** */
 
-unsigned
-CNameMemPool::pendingChainLength (const valtype& name) const
+COutPoint
+CNameMemPool::lastNameOutput (const valtype& name) const
 {
-  unsigned res = 0;
-  if (registersName (name))
-    ++res;
+  const auto* chain = getPendingChain (name);
+  if (chain == nullptr)
+    return COutPoint ();
 
-  const auto mit = updates.find (name);
-  if (mit != updates.end ())
-    res += mit->second.size ();
-
-  return res;
+  assert (!chain->empty ());
+  return chain->back ().output;
 }
 
 namespace
 {
 
 /**
- * Returns the outpoint matching the name operation in a given mempool tx, if
- * there is any.  The txid must be for an entry in the mempool.
+ * Returns true if the given transaction spends any output of the
+ * transaction with the given txid.
  */
-COutPoint
-getNameOutput (const CTxMemPool& pool, const uint256& txid)
+bool
+SpendsFrom (const CTransaction& tx, const uint256& txid)
 {
-  AssertLockHeld (pool.cs);
-
-  const auto mit = pool.mapTx.find (txid);
-  assert (mit != pool.mapTx.end ());
-  const auto& vout = mit->GetTx ().vout;
-
-  for (unsigned i = 0; i != vout.size (); ++i)
-    {
-      const CNameScript nameOp(vout[i].scriptPubKey);
-      if (nameOp.isNameOp ())
-        return COutPoint (txid, i);
-    }
+  for (const auto& in : tx.vin)
+    if (in.prevout.hash == txid)
+      return true;
+  return false;
+}
 
-  return COutPoint ();
+/**
+ * Returns the heap memory used by a game ID string.  Short strings are
+ * stored inline and do not allocate.
+ */
+size_t
+GameIdUsage (const std::string& game)
+{
+  const char* data = game.data ();
+  const char* obj = reinterpret_cast<const char*> (&game);
+  if (data >= obj && data < obj + sizeof (game))
+    return 0;
+  return memusage::MallocUsage (game.capacity () + 1);
 }
 
 } // anonymous namespace
 
-COutPoint
-CNameMemPool::lastNameOutput (const valtype& name) const
+void
+CNameMemPool::addMoveTx (const CNameScript& op, const CTransactionRef& tx)
 {
-  const auto itUpd = updates.find (name);
-  if (itUpd != updates.end ())
+  /* Only updates of p/ names can be moves.  Their values are only scanned
+     for the game IDs here, and decoded fully when the moves are requested
+     without holding the mempool lock.  */
+  const valtype& name = op.getOpName ();
+  if (name.size () < 2 || name[0] != 'p' || name[1] != '/')
+    return;
+
+  const valtype& value = op.getOpValue ();
+  MoveTx entry;
+  entry.tx = tx;
+  const bool scanned
+      = ExtractMoveGameIds (std::string (value.begin (), value.end ()),
+                            entry.games);
+  if (!scanned)
+    entry.games.clear ();
+  else if (entry.games.empty ())
+    return;
+
+  const uint64_t key = nextMoveKey++;
+  const auto& games = moveTxs.emplace (key, std::move (entry)).first
+                        ->second.games;
+  moveTxKeys.emplace (tx->GetHash (), key);
+
+  if (!scanned)
+    unscannedMoveTxs.insert (key);
+  for (const auto& game : games)
     {
-      /* From all the pending updates, we have to find the last one.  This is
-         the unique outpoint that is not also spent by some other transaction.
-         Thus, we keep track of all the transactions spent as well, and then
-         remove those from the sets of candidates.  Doing so by txid (rather
-         than outpoint) is enough, as those transactions must be in a "chain"
-         anyway.  */
+      cachedMoveUsage += memusage::IncrementalDynamicUsage (games)
+                          + GameIdUsage (game);
 
-      const std::set<uint256>& candidateTxids = itUpd->second;
-      std::set<uint256> spentTxids;
-
-      for (const auto& txid : candidateTxids)
+      auto mit = moveTxsByGame.find (game);
+      if (mit == moveTxsByGame.end ())
         {
-          const auto mit = pool.mapTx.find (txid);
-          assert (mit != pool.mapTx.end ());
-          for (const auto& in : mit->GetTx ().vin)
-            spentTxids.insert (in.prevout.hash);
+          mit = moveTxsByGame.emplace (game, std::set<uint64_t> ()).first;
+          cachedMoveUsage += GameIdUsage (mit->first);
         }
+      mit->second.insert (key);
+      cachedMoveUsage += memusage::IncrementalDynamicUsage (mit->second);
+    }
+}
 
-      COutPoint res;
-      for (const auto& txid : candidateTxids)
-        {
-          if (spentTxids.count (txid) > 0)
-            continue;
+void
+CNameMemPool::removeMoveTx (const uint256& txid)
+{
+  const auto mitKey = moveTxKeys.find (txid);
+  if (mitKey == moveTxKeys.end ())
+    return;
 
-          assert (res.IsNull ());
-          res = getNameOutput (pool, txid);
-        }
+  const uint64_t key = mitKey->second;
+  const auto mitTx = moveTxs.find (key);
+  assert (mitTx != moveTxs.end ());
 
-      assert (!res.IsNull ());
-      return res;
+  const auto& games = mitTx->second.games;
+  for (const auto& game : games)
+    {
+      cachedMoveUsage -= memusage::IncrementalDynamicUsage (games)
+                          + GameIdUsage (game);
+
+      const auto mit = moveTxsByGame.find (game);
+      assert (mit != moveTxsByGame.end ());
+      cachedMoveUsage -= memusage::IncrementalDynamicUsage (mit->second);
+      mit->second.erase (key);
+      if (mit->second.empty ())
+        {
+          cachedMoveUsage -= GameIdUsage (mit->first);
+          moveTxsByGame.erase (mit);
+        }
     }
 
-  const auto itReg = mapNameRegs.find (name);
-  if (itReg != mapNameRegs.end ())
-    return getNameOutput (pool, itReg->second);
+  unscannedMoveTxs.erase (key);
+  moveTxs.erase (mitTx);
+  moveTxKeys.erase (mitKey);
+}
+
+CNameMemPool::MoveTxs
+CNameMemPool::getMoveTxs (const std::string& game) const
+{
+  AssertLockHeld (pool.cs);
 
-  return COutPoint ();
+  /* Both sets of keys are in mempool order, so merging them yields the
+     transactions in that order as well.  */
+  std::vector<uint64_t> keys;
+  const auto mit = moveTxsByGame.find (game);
+  if (mit == moveTxsByGame.end ())
+    keys.assign (unscannedMoveTxs.begin (), unscannedMoveTxs.end ());
+  else
+    std::set_union (mit->second.begin (), mit->second.end (),
+                    unscannedMoveTxs.begin (), unscannedMoveTxs.end (),
+                    std::back_inserter (keys));
+
+  MoveTxs res;
+  res.reserve (keys.size ());
+  for (const uint64_t key : keys)
+    res.push_back (moveTxs.at (key).tx);
+
+  return res;
+}
+
+size_t
+CNameMemPool::DynamicMemoryUsage () const
+{
+  return memusage::DynamicUsage (moveTxs)
+          + memusage::DynamicUsage (moveTxKeys)
+          + memusage::DynamicUsage (moveTxsByGame)
+          + memusage::DynamicUsage (unscannedMoveTxs)
+          + cachedMoveUsage;
 }
 
 void
@@ -114,15 +186,42 @@ CNameMemPool::addUnchecked (const CTxMemPoolEntry& entry)
       mapNameRegs.insert (std::make_pair (name, txHash));
     }
 
-  if (entry.isNameUpdate ())
+  if (entry.isNameRegistration () || entry.isNameUpdate ())
     {
-      const valtype& name = entry.getName ();
-      const auto mit = updates.find (name);
-
-      if (mit == updates.end ())
-        updates.emplace (name, std::set<uint256> ({txHash}));
-      else
-        mit->second.insert (txHash);
+      const auto& tx = entry.GetSharedTx ();
+      PendingOp op;
+      op.tx = tx;
+      for (unsigned i = 0; i < tx->vout.size (); ++i)
+        {
+          op.op = CNameScript (tx->vout[i].scriptPubKey);
+          if (op.op.isNameOp ())
+            {
+              op.output = COutPoint (txHash, i);
+              break;
+            }
+        }
+      assert (!op.output.IsNull ());
+      addMoveTx (op.op, tx);
+
+      /* Usually the new operation spends the last one in the chain.  But when
+         blocks are disconnected, their transactions are added back (oldest
+         first) while the mempool may already contain operations spending
+         them.  Thus insert the new operation right after the last one it
+         depends on.  If it depends on none in the chain, it spends the name's
+         confirmed output and starts the chain, unless that is a registration
+         (which has to stay first).  */
+      auto& chain = pending[entry.getName ()];
+      const auto rit = std::find_if (chain.rbegin (), chain.rend (),
+                                     [&op] (const PendingOp& other)
+                                       {
+                                         return SpendsFrom (*op.tx,
+                                                            other.output.hash);
+                                       });
+      auto pos = rit.base ();
+      if (rit == chain.rend () && !chain.empty ()
+            && chain.front ().op.getNameOp () == OP_NAME_REGISTER)
+        pos = chain.end ();
+      chain.insert (pos, std::move (op));
     }
 }
 
@@ -138,16 +237,23 @@ CNameMemPool::remove (const CTxMemPoolEntry& entry)
       mapNameRegs.erase (mit);
     }
 
-  if (entry.isNameUpdate ())
+  if (entry.isNameRegistration () || entry.isNameUpdate ())
     {
-      const auto itName = updates.find (entry.getName ());
-      assert (itName != updates.end ());
-      auto& txids = itName->second;
-      const auto itTxid = txids.find (entry.GetTx ().GetHash ());
-      assert (itTxid != txids.end ());
-      txids.erase (itTxid);
-      if (txids.empty ())
-        updates.erase (itName);
+      const auto itName = pending.find (entry.getName ());
+      assert (itName != pending.end ());
+      auto& chain = itName->second;
+      const uint256& txHash = entry.GetTx ().GetHash ();
+      const auto itOp = std::find_if (chain.begin (), chain.end (),
+                                      [&txHash] (const PendingOp& op)
+                                        {
+                                          return op.output.hash == txHash;
+                                        });
+      assert (itOp != chain.end ());
+      chain.erase (itOp);
+      if (chain.empty ())
+        pending.erase (itName);
+
+      removeMoveTx (txHash);
     }
 }
 
@@ -182,7 +288,7 @@ CNameMemPool::check (CChainState& active_chainstate) const
   const auto& coins = active_chainstate.CoinsTip ();
 
   std::set<valtype> nameRegs;
-  std::map<valtype, unsigned> nameUpdates;
+  std::map<valtype, unsigned> nameOps;
   for (const auto& entry : pool.mapTx)
     {
       const uint256 txHash = entry.GetTx ().GetHash ();
@@ -196,6 +302,7 @@ CNameMemPool::check (CChainState& active_chainstate) const
 
           assert (nameRegs.count (name) == 0);
           nameRegs.insert (name);
+          ++nameOps[name];
 
           /* There should be no existing name.  */
           CNameData data;
@@ -206,11 +313,7 @@ CNameMemPool::check (CChainState& active_chainstate) const
         {
           const valtype& name = entry.getName ();
 
-          const auto mit = updates.find (name);
-          assert (mit != updates.end ());
-          assert (mit->second.count (txHash) > 0);
-
-          ++nameUpdates[name];
+          ++nameOps[name];
 
           CNameData data;
           if (!coins.GetName (name, data))
@@ -219,9 +322,45 @@ CNameMemPool::check (CChainState& active_chainstate) const
     }
 
   assert (nameRegs.size () == mapNameRegs.size ());
-  assert (nameUpdates.size () == updates.size ());
-  for (const auto& upd : nameUpdates)
-    assert (updates.at (upd.first).size () == upd.second);
+  assert (nameOps.size () == pending.size ());
+  for (const auto& entry : pending)
+    {
+      const auto& chain = entry.second;
+      assert (chain.size () == nameOps.at (entry.first));
+
+      /* The registration (if any) must come first in the chain.  */
+      for (size_t i = 0; i < chain.size (); ++i)
+        {
+          const auto& op = chain[i];
+          assert (pool.exists (op.output.hash));
+          assert (op.op.getOpName () == entry.first);
+          if (op.op.getNameOp () == OP_NAME_REGISTER)
+            assert (i == 0);
+        }
+    }
+
+  assert (moveTxs.size () == moveTxKeys.size ());
+  for (const auto& entry : moveTxKeys)
+    {
+      assert (pool.exists (entry.first));
+      assert (moveTxs.at (entry.second).tx->GetHash () == entry.first);
+    }
+
+  size_t numIndexed = 0;
+  for (const auto& entry : moveTxs)
+    {
+      const auto& games = entry.second.games;
+      assert (games.empty () == (unscannedMoveTxs.count (entry.first) > 0));
+      for (const auto& game : games)
+        assert (moveTxsByGame.at (game).count (entry.first) > 0);
+      numIndexed += games.size ();
+    }
+  for (const auto& entry : moveTxsByGame)
+    {
+      assert (!entry.second.empty ());
+      numIndexed -= entry.second.size ();
+    }
+  assert (numIndexed == 0);
 }
 
 bool
@@ -259,3 +398,19 @@ CNameMemPool::checkTx (const CTransaction& tx) const
 
   return true;
 }
+
+std::vector<UniValue>
+GetPendingMoves (const CNameMemPool::MoveTxs& txs, const std::string& game)
+{
+  std::vector<UniValue> res;
+  for (const auto& tx : txs)
+    {
+      const GameTransactionData data(*tx);
+      const auto& moves = data.GetMovesPerGame ();
+      const auto mit = moves.find (game);
+      if (mit != moves.end ())
+        res.push_back (mit->second);
+    }
+
+  return res;
+}
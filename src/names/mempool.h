@@ -7,11 +7,18 @@
 
 #include <names/common.h>
 #include <primitives/transaction.h>
+#include <script/names.h>
 #include <uint256.h>
 
+#include <univalue.h>
+
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
+#include <utility>
+#include <vector>
 
 class CChainState;
 class ChainstateManager;
@@ -37,6 +44,44 @@ static constexpr unsigned DEFAULT_NAME_CHAIN_LIMIT = 20;
 class CNameMemPool
 {
 
+public:
+
+  /**
+   * A pending name operation in the mempool.  The decoded name script
+   * is kept so that it need not be parsed again e.g. for name_pending.
+   */
+  struct PendingOp
+  {
+
+    /** The transaction with the name operation.  */
+    CTransactionRef tx;
+
+    /** The name output of the transaction.  */
+    COutPoint output;
+
+    /** The decoded name operation.  */
+    CNameScript op;
+
+  };
+
+  /**
+   * The pending operations on a single name, in the order in which they
+   * spend each other's name outputs.
+   */
+  using PendingChain = std::vector<PendingOp>;
+
+  /** Pending operations of all names.  */
+  using PendingMap = std::map<valtype, PendingChain>;
+
+  /**
+   * The transactions in the mempool that may have moves (i.e. that register
+   * or update p/ names), in the order in which they have been added.  Only
+   * references are kept, so that adding them is cheap and their memory is
+   * accounted for with the mempool entries.  The moves themselves are
+   * decoded with GetPendingMoves when needed, outside the mempool lock.
+   */
+  using MoveTxs = std::vector<CTransactionRef>;
+
 private:
 
   /** The parent mempool object.  Used to e.g. remove conflicting tx.  */
@@ -50,15 +95,61 @@ private:
   std::map<valtype, uint256> mapNameRegs;
 
   /**
-   * Keep track of all transactions that update a given name.  For each name,
-   * this may be a whole chain of updates.  This field is used to remove the
-   * transactions from the mempool should the name expire (and the updates
-   * thus become invalid).
-   *
-   * We also use this to determine the length of chains of pending name_update
-   * operations.
+   * Keep track of all transactions that register or update a given name.
+   * For each name, this may be a whole chain of operations.  They are kept
+   * in the order of the chain, so that the length of the chain and the
+   * last name output are directly available.
+   */
+  PendingMap pending;
+
+  /** A potential move transaction and the games it has moves for.  */
+  struct MoveTx
+  {
+
+    /** The transaction itself.  */
+    CTransactionRef tx;
+
+    /**
+     * The games found in the value by ExtractMoveGameIds.  This is empty
+     * if the value could not be scanned, in which case the transaction is
+     * in unscannedMoveTxs instead of moveTxsByGame.
+     */
+    std::set<std::string> games;
+
+  };
+
+  /** Potential move transactions, keyed by the order they were added.  */
+  std::map<uint64_t, MoveTx> moveTxs;
+
+  /** For each transaction in moveTxs, its key there.  */
+  std::map<uint256, uint64_t> moveTxKeys;
+
+  /** Keys in moveTxs of the transactions with moves for each game.  */
+  std::map<std::string, std::set<uint64_t>> moveTxsByGame;
+
+  /**
+   * Keys in moveTxs of the transactions whose values could not be scanned
+   * for the game IDs.  They are returned as potential moves for all games.
    */
-  std::map<valtype, std::set<uint256>> updates;
+  std::set<uint64_t> unscannedMoveTxs;
+
+  /** Key for the next transaction added to moveTxs.  */
+  uint64_t nextMoveKey = 0;
+
+  /**
+   * Memory used by the move index for the game sets and IDs, which is
+   * not included in the usage of the containers themselves.
+   */
+  size_t cachedMoveUsage = 0;
+
+  /**
+   * Records a newly added transaction with the given name operation as
+   * potential move, if it is for a p/ name and may have moves.
+   */
+  void addMoveTx (const CNameScript& op, const CTransactionRef& tx);
+
+  /** Removes the given transaction from the move index, if it is there.  */
+  void removeMoveTx (const uint256& txid);
 
 public:
 
@@ -87,10 +178,10 @@ public:
   bool
   updatesName (const valtype& name) const
   {
-    const auto mit = updates.find (name);
-    if (mit == updates.end ())
+    const auto mit = pending.find (name);
+    if (mit == pending.end ())
       return false;
-    return !mit->second.empty ();
+    return mit->second.size () > (registersName (name) ? 1 : 0);
   }
 
   /**
@@ -98,7 +189,49 @@ public:
    * In other words, this is the "length" of the chain of operations that
    * are already pending.
    */
-  unsigned pendingChainLength (const valtype& name) const;
+  unsigned
+  pendingChainLength (const valtype& name) const
+  {
+    const auto mit = pending.find (name);
+    if (mit == pending.end ())
+      return 0;
+    return mit->second.size ();
+  }
+
+  /**
+   * Returns the chain of pending operations on the given name, or null
+   * if there are none.
+   */
+  const PendingChain*
+  getPendingChain (const valtype& name) const
+  {
+    const auto mit = pending.find (name);
+    if (mit == pending.end ())
+      return nullptr;
+    return &mit->second;
+  }
+
+  /**
+   * Returns the pending operations on all names, ordered by name.
+   */
+  const PendingMap&
+  getPending () const
+  {
+    return pending;
+  }
+
+  /**
+   * Returns the transactions that may have moves for the given game, in
+   * mempool order.  They can be decoded with GetPendingMoves after
+   * releasing the lock.
+   */
+  MoveTxs getMoveTxs (const std::string& game) const;
+
+  /**
+   * Returns the memory used by the index of potential moves, so that it
+   * can be included in the mempool's usage.
+   */
+  size_t DynamicMemoryUsage () const;
 
   /**
    * Returns the last outpoint of a (potential) chain of pending name operations
@@ -115,7 +248,12 @@ public:
   clear ()
   {
     mapNameRegs.clear ();
-    updates.clear ();
+    pending.clear ();
+    moveTxs.clear ();
+    moveTxKeys.clear ();
+    moveTxsByGame.clear ();
+    unscannedMoveTxs.clear ();
+    cachedMoveUsage = 0;
   }
 
   /**
@@ -149,4 +287,13 @@ public:
 
 };
 
+/**
+ * Decodes the given potential move transactions (as returned by
+ * CNameMemPool::getMoveTxs for the game) and returns the moves for the
+ * game, in the same order and as objects like in game-pending-move
+ * notifications.
+ */
+std::vector<UniValue> GetPendingMoves (const CNameMemPool::MoveTxs& txs,
+                                       const std::string& game);
+
 #endif // H_BITCOIN_NAMES_MEMPOOL
@@ -0,0 +1 @@
+#define BUILD_GIT_COMMIT "2602918a7fbc"
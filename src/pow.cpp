@@ -47,12 +47,9 @@ GetNextWorkRequired (const PowAlgo algo, const CBlockIndex* pindexLast,
       if (nCountBlocks == nPastBlocks)
         pindexFirst = pindex;
 
-      /* We need to step back to the last block with the given algo, but at
-         least one block.  Note that GetLastAncestorWithAlgo returns the
-         block itself if it matches.  */
-      pindex = pindex->pprev;
-      if (pindex != nullptr)
-        pindex = pindex->GetLastAncestorWithAlgo (algo);
+      /* We need to step back to the last previous block with the given
+         algo, which is linked directly from the block index.  */
+      pindex = pindex->pprevSameAlgo;
 
       if (pindex == nullptr)
         return bnPowLimit.GetCompact ();
@@ -127,6 +127,28 @@ PowData::initAuxpow (const CPureBlockHeader& block)
 
 bool
 PowData::isValid (const uint256& hash, const Consensus::Params& params) const
+{
+  return checkValidity (hash, nullptr, params);
+}
+
+bool
+PowData::isValid (const uint256& hash, const uint256& powHash,
+                  const Consensus::Params& params) const
+{
+  return checkValidity (hash, &powHash, params);
+}
+
+const CPureBlockHeader*
+PowData::getPowHeader () const
+{
+  if (isMergeMined ())
+    return auxpow == nullptr ? nullptr : &auxpow->parentBlock;
+  return fakeHeader.get ();
+}
+
+bool
+PowData::checkValidity (const uint256& hash, const uint256* powHash,
+                        const Consensus::Params& params) const
 {
   switch (getCoreAlgo ())
     {
@@ -146,7 +168,9 @@ PowData::isValid (const uint256& hash, const Consensus::Params& params) const
     {
       if (auxpow == nullptr)
         return error ("%s: merge-mined PoW data has no auxpow", __func__);
-      if (!checkProofOfWork (auxpow->parentBlock, params))
+      if (powHash != nullptr
+            ? !checkProofOfWork (getCoreAlgo (), *powHash, getBits (), params)
+            : !checkProofOfWork (auxpow->parentBlock, params))
         return error ("%s: auxpow PoW is invalid", __func__);
       if (!auxpow->check (hash, params.nAuxpowChainId, params))
         return error ("%s: auxpow is invalid", __func__);
@@ -157,7 +181,9 @@ PowData::isValid (const uint256& hash, const Consensus::Params& params) const
         return error ("%s: stand-alone PoW data has no fake header", __func__);
       if (fakeHeader->hashMerkleRoot != hash)
         return error ("%s: fake header commits to wrong hash", __func__);
-      if (!checkProofOfWork (*fakeHeader, params))
+      if (powHash != nullptr
+            ? !checkProofOfWork (getCoreAlgo (), *powHash, getBits (), params)
+            : !checkProofOfWork (*fakeHeader, params))
         return error ("%s: fake header PoW is invalid", __func__);
     }
 
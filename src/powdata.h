@@ -95,6 +95,13 @@ private:
 
   friend class powdata_tests::PowDataForTest;
 
+  /**
+   * Implements isValid.  If powHash is not null, it is used as the already
+   * computed PoW hash of getPowHeader().
+   */
+  bool checkValidity (const uint256& hash, const uint256* powHash,
+                      const Consensus::Params& params) const;
+
 public:
 
   inline PowData ()
@@ -178,6 +185,21 @@ public:
    */
   bool isValid (const uint256& hash, const Consensus::Params& params) const;
 
+  /**
+   * Verifies the PoW like isValid, but with the PoW hash of getPowHeader()
+   * already computed by the caller.  This is used to check the PoW of many
+   * headers with a single call to GetPowHashes.
+   */
+  bool isValid (const uint256& hash, const uint256& powHash,
+                const Consensus::Params& params) const;
+
+  /**
+   * Returns the header whose PoW hash is checked by isValid, i.e. the
+   * parent block of the auxpow or the fake header.  Returns null if there
+   * is neither.
+   */
+  const CPureBlockHeader* getPowHeader () const;
+
   inline const CAuxPow&
   getAuxpow () const
   {
@@ -22,21 +22,39 @@ uint256 CPureBlockHeader::GetHash() const
 namespace
 {
 
-uint256
-GetNeoscryptHash (const CPureBlockHeader& hdr)
+/** Size of the serialised header that is hashed with Neoscrypt.  */
+constexpr size_t NEOSCRYPT_INPUT_SIZE = 80;
+
+/**
+ * Appends the Neoscrypt input for the given header to data.
+ */
+void
+AppendNeoscryptInput (const CPureBlockHeader& hdr,
+                      std::vector<unsigned char>& data)
 {
-  std::vector<unsigned char> data;
-  CVectorWriter writer(SER_GETHASH, PROTOCOL_VERSION, data, 0);
+  std::vector<unsigned char> serialised;
+  CVectorWriter writer(SER_GETHASH, PROTOCOL_VERSION, serialised, 0);
   writer << hdr;
+  assert (serialised.size () == NEOSCRYPT_INPUT_SIZE);
 
   /* We swap the byte order similar to what getwork does, as that seems to be
      how common mining software implements neoscrypt.  It does not really matter
      from the PoW point of view, so we can just choose to be compatible.  */
-  SwapGetWorkEndianness (data);
+  SwapGetWorkEndianness (serialised);
+
+  data.insert (data.end (), serialised.begin (), serialised.end ());
+}
+
+constexpr int NEOSCRYPT_PROFILE = 0;
+
+uint256
+GetNeoscryptHash (const CPureBlockHeader& hdr)
+{
+  std::vector<unsigned char> data;
+  AppendNeoscryptInput (hdr, data);
 
-  constexpr int profile = 0;
   uint256 hash;
-  neoscrypt (&data[0], hash.begin(), profile);
+  neoscrypt (&data[0], hash.begin(), NEOSCRYPT_PROFILE);
 
   return hash;
 }
@@ -56,6 +74,35 @@ uint256 CPureBlockHeader::GetPowHash (const PowAlgo algo) const
     }
 }
 
+std::vector<uint256>
+GetPowHashes (const std::vector<const CPureBlockHeader*>& headers,
+              const PowAlgo algo)
+{
+  std::vector<uint256> hashes(headers.size ());
+  if (algo != PowAlgo::NEOSCRYPT)
+    {
+      for (size_t i = 0; i < headers.size (); ++i)
+        hashes[i] = headers[i]->GetPowHash (algo);
+      return hashes;
+    }
+
+  std::vector<unsigned char> data;
+  data.reserve (headers.size () * NEOSCRYPT_INPUT_SIZE);
+  for (const auto* hdr : headers)
+    AppendNeoscryptInput (*hdr, data);
+
+  std::vector<unsigned char> out(headers.size () * uint256::size ());
+  neoscrypt_multi (data.data (), out.data (), NEOSCRYPT_PROFILE,
+                   headers.size ());
+
+  for (size_t i = 0; i < headers.size (); ++i)
+    std::copy (out.begin () + i * uint256::size (),
+               out.begin () + (i + 1) * uint256::size (),
+               hashes[i].begin ());
+
+  return hashes;
+}
+
 void
 SwapGetWorkEndianness (std::vector<unsigned char>& data)
 {
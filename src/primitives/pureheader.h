@@ -62,6 +62,14 @@ public:
     }
 };
 
+/**
+ * Computes the PoW hashes of a batch of headers for the given algo.  This is
+ * the same as calling GetPowHash on each of them, but hashes several headers
+ * at once with the multi-lane Neoscrypt kernels where available.
+ */
+std::vector<uint256> GetPowHashes (
+    const std::vector<const CPureBlockHeader*>& headers, PowAlgo algo);
+
 /**
  * Swaps the endian-ness of each 4-byte word in the given vector of bytes.
  * This is used for getwork and also for our neoscrypt PoW hash.
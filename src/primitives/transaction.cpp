@@ -78,17 +78,53 @@ uint256 CTransaction::ComputeWitnessHash() const
     return SerializeHash(*this, SER_GETHASH, 0);
 }
 
+uint256 CTransaction::ComputeBareHash() const
+{
+    /* This serialises the transaction like SerializeTransaction without
+       witness, except that all scriptSig's are written as empty.  */
+    CHashWriter ss(SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS);
+    ss << nVersion;
+    WriteCompactSize(ss, vin.size());
+    for (const auto& in : vin) {
+        ss << in.prevout;
+        WriteCompactSize(ss, 0);
+        ss << in.nSequence;
+    }
+    ss << vout;
+    ss << nLockTime;
+    return ss.GetHash();
+}
+
 uint256 CTransaction::GetBareHash() const
 {
-    CMutableTransaction withoutSigs(*this);
-    for (auto& in : withoutSigs.vin)
-      in.scriptSig.clear();
-    return withoutSigs.GetHash();
+    if (m_bare_hash_state.load(std::memory_order_acquire) == BARE_HASH_READY) {
+        return m_bare_hash;
+    }
+
+    const uint256 res = ComputeBareHash();
+
+    /* If another thread is computing the hash at the same time, we just
+       return our own result and let that thread store it.  */
+    uint8_t expected = BARE_HASH_NONE;
+    if (m_bare_hash_state.compare_exchange_strong(expected, BARE_HASH_COMPUTING, std::memory_order_acq_rel)) {
+        m_bare_hash = res;
+        m_bare_hash_state.store(BARE_HASH_READY, std::memory_order_release);
+    }
+
+    return res;
 }
 
 CTransaction::CTransaction(const CMutableTransaction& tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
 CTransaction::CTransaction(CMutableTransaction&& tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
 
+CTransaction::CTransaction(const CTransaction& tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash(tx.hash), m_witness_hash(tx.m_witness_hash)
+{
+    if (tx.m_bare_hash_state.load(std::memory_order_acquire) == BARE_HASH_READY) {
+        m_bare_hash = tx.m_bare_hash;
+        m_bare_hash_state.store(BARE_HASH_READY, std::memory_order_relaxed);
+    }
+}
+
 CAmount CTransaction::GetValueOut(bool fExcludeNames) const
 {
     CAmount nValueOut = 0;
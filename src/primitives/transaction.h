@@ -12,6 +12,7 @@
 #include <serialize.h>
 #include <uint256.h>
 
+#include <atomic>
 #include <tuple>
 
 /**
@@ -277,13 +278,27 @@ private:
     const uint256 hash;
     const uint256 m_witness_hash;
 
+    /**
+     * Memory only.  The bare hash is computed lazily on first use and
+     * cached.  Only the thread that moves m_bare_hash_state from
+     * BARE_HASH_NONE to BARE_HASH_COMPUTING writes m_bare_hash, and it is
+     * read only after the state is BARE_HASH_READY.
+     */
+    static constexpr uint8_t BARE_HASH_NONE = 0;
+    static constexpr uint8_t BARE_HASH_COMPUTING = 1;
+    static constexpr uint8_t BARE_HASH_READY = 2;
+    mutable std::atomic<uint8_t> m_bare_hash_state{BARE_HASH_NONE};
+    mutable uint256 m_bare_hash;
+
     uint256 ComputeHash() const;
     uint256 ComputeWitnessHash() const;
+    uint256 ComputeBareHash() const;
 
 public:
     /** Convert a CMutableTransaction into a CTransaction. */
     explicit CTransaction(const CMutableTransaction& tx);
     CTransaction(CMutableTransaction&& tx);
+    CTransaction(const CTransaction& tx);
 
     template <typename Stream>
     inline void Serialize(Stream& s) const {
@@ -308,6 +323,8 @@ public:
      * before computing.  In other words, it is a hash that commits to the
      * transaction details in general, but is not malleable independent of
      * whether or not segwit is used by the inputs.
+     *
+     * It is computed on first use and then cached; this is thread-safe.
      */
     uint256 GetBareHash() const;
 
@@ -6,7 +6,9 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <core_io.h>
+#include <games/blockdata.h>
 #include <httpserver.h>
+#include <index/gamemoves.h>
 #include <index/txindex.h>
 #include <names/common.h>
 #include <names/encoding.h>
@@ -27,12 +29,16 @@
 #include <version.h>
 
 #include <any>
+#include <memory>
+#include <set>
 
 #include <boost/algorithm/string.hpp>
 
 #include <univalue.h>
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const long MAX_REST_GAMEMOVES_BLOCKS = 10000;
+static const size_t REST_GAMEMOVES_CHUNK_SIZE = 64 * 1024;
 
 enum class RetFormat {
     UNDEF,
@@ -819,6 +825,90 @@ static bool rest_name(const std::any& context, HTTPRequest* req, const std::stri
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+/**
+ * Returns the moves and admin commands of a game for a range of blocks
+ * on the active chain. The response is streamed block by block as a
+ * chunked reply, so that game daemons can catch up on many blocks without
+ * the node building the whole result in memory.
+ */
+static bool rest_game_moves(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    if (rf != RetFormat::JSON)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+    if (path.size() != 3 || path[0].empty())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Use /rest/gamemoves/<gameid>/<count>/<hash>.json.");
+    const std::string& gameid = path[0];
+
+    long count = strtol(path[1].c_str(), nullptr, 10);
+    if (count < 1 || count > MAX_REST_GAMEMOVES_BLOCKS)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + path[1]);
+
+    uint256 hash;
+    if (!ParseHashStr(path[2], hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + path[2]);
+
+    ChainstateManager* maybe_chainman = GetChainman(context, req);
+    if (!maybe_chainman) return false;
+    ChainstateManager& chainman = *maybe_chainman;
+
+    const CBlockIndex* pindex = nullptr;
+    {
+        LOCK(cs_main);
+        pindex = chainman.m_blockman.LookupBlockIndex(hash);
+        if (!pindex || !chainman.ActiveChain().Contains(pindex))
+            return RESTERR(req, HTTP_NOT_FOUND, hash.GetHex() + " not found in active chain");
+    }
+
+    const std::set<std::string> games = {gameid};
+    req->WriteHeader("Content-Type", "application/json");
+    req->StartChunkedReply(HTTP_OK);
+
+    std::string chunk = "[";
+    for (long i = 0; i < count && pindex != nullptr; ++i) {
+        std::shared_ptr<const GameBlockData> data;
+        if (g_game_move_index) data = g_game_move_index->FindBlockData(*pindex, games);
+        if (!data) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+                // The block may have been pruned; there is no way to report
+                // an error any more, so just end the result here.
+                break;
+            }
+            data = std::make_shared<const GameBlockData>(block);
+        }
+
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("block", data->GetBlockJson(*pindex));
+        data->AddGameJson(gameid, entry);
+        if (i > 0) chunk += ",";
+        chunk += entry.write();
+
+        if (chunk.size() >= REST_GAMEMOVES_CHUNK_SIZE) {
+            if (!req->WriteReplyChunk(chunk)) {
+                req->EndChunkedReply();
+                return true;
+            }
+            chunk.clear();
+        }
+
+        // Stop early if the block is no longer on the active chain
+        // after a reorg, so that the result is always a chain segment.
+        LOCK(cs_main);
+        pindex = chainman.ActiveChain().Next(pindex);
+    }
+    chunk += "]\n";
+    req->WriteReplyChunk(chunk);
+    req->EndChunkedReply();
+    return true;
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(const std::any& context, HTTPRequest* req, const std::string& strReq);
@@ -833,6 +923,7 @@ static const struct {
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
       {"/rest/name/", rest_name},
+      {"/rest/gamemoves/", rest_game_moves},
 };
 
 void StartREST(const std::any& context)
@@ -7,6 +7,8 @@
 #include <arith_uint256.h>
 #include <auxpow.h>
 #include <chainparams.h>
+#include <key_io.h>
+#include <logging.h>
 #include <net.h>
 #include <node/context.h>
 #include <primitives/pureheader.h>
@@ -14,12 +16,17 @@
 #include <rpc/net.h>
 #include <rpc/protocol.h>
 #include <rpc/request.h>
+#include <rpc/server.h>
 #include <streams.h>
 #include <util/strencodings.h>
+#include <util/string.h>
+#include <util/thread.h>
 #include <util/time.h>
 #include <validation.h>
 
 #include <cassert>
+#include <chrono>
+#include <iterator>
 
 namespace
 {
@@ -41,73 +48,318 @@ void auxMiningCheck(const JSONRPCRequest& request)
                         "SpaceXpanse is downloading blocks...");
 }
 
+/**
+ * Returns the difficulty target of the given block.
+ */
+uint256
+GetBlockTarget (const CBlock& block)
+{
+  arith_uint256 arithTarget;
+  bool fNegative, fOverflow;
+  arithTarget.SetCompact (block.pow.getBits (), &fNegative, &fOverflow);
+  if (fNegative || fOverflow || arithTarget == 0)
+    throw std::runtime_error ("invalid difficulty bits in block");
+
+  return ArithToUint256 (arithTarget);
+}
+
+// Copied from the diff in https://github.com/bitcoin/bitcoin/pull/4100.
+int
+FormatHashBlocks(void* pbuffer, unsigned int len)
+{
+    unsigned char* pdata = (unsigned char*)pbuffer;
+    unsigned int blocks = 1 + ((len + 8) / 64);
+    unsigned char* pend = pdata + 64 * blocks;
+    memset(pdata + len, 0, 64 * blocks - len);
+    pdata[len] = 0x80;
+    unsigned int bits = len * 8;
+    pend[-1] = (bits >> 0) & 0xff;
+    pend[-2] = (bits >> 8) & 0xff;
+    pend[-3] = (bits >> 16) & 0xff;
+    pend[-4] = (bits >> 24) & 0xff;
+    return blocks;
+}
+
+/**
+ * Returns the work JSON for a block as pushed to listeners, which has the
+ * payout address added.
+ */
+UniValue
+AddPayoutAddress (UniValue work, const CBlock& block)
+{
+  CTxDestination dest;
+  if (ExtractDestination (block.vtx[0]->vout[0].scriptPubKey, dest))
+    work.pushKV ("address", EncodeDestination (dest));
+
+  return work;
+}
+
+/**
+ * Constructs the "data" field for stand-alone mining of the given block,
+ * as returned by creatework.
+ */
+std::vector<unsigned char>
+GetWorkData (const CBlock& block)
+{
+  CPureBlockHeader fakeHeader;
+  fakeHeader.SetNull ();
+  fakeHeader.hashMerkleRoot = block.GetHash ();
+
+  /* To construct the data result, we first have to serialise the template
+     fake header of the PoW data.  Then perform the byte-order swapping and
+     add zero-padding up to 128 bytes.  */
+  std::vector<unsigned char> data;
+  CVectorWriter writer(SER_GETHASH, PROTOCOL_VERSION, data, 0);
+  writer << fakeHeader;
+  const size_t len = data.size ();
+  data.resize (128, 0);
+  FormatHashBlocks (&data[0], len);
+  SwapGetWorkEndianness (data);
+
+  return data;
+}
+
 }  // anonymous namespace
 
-const CBlock*
-AuxpowMiner::getCurrentBlock (const ChainstateManager& chainman,
-                              const CTxMemPool& mempool,
-                              const PowAlgo algo,
-                              const CScript& scriptPubKey, uint256& target)
+AuxpowMiner::BaseTemplate
+AuxpowMiner::createBaseTemplate (const ChainstateManager& chainman,
+                                 const CTxMemPool& mempool, const PowAlgo algo)
+{
+  LOCK (cs_main);
+
+  BaseTemplate res;
+  res.txUpdated = mempool.GetTransactionsUpdated ();
+
+  /* The payout script is filled in for each miner later on.  */
+  std::unique_ptr<CBlockTemplate> newBlock
+      = BlockAssembler (chainman.ActiveChainstate (), mempool, Params ())
+          .CreateNewBlock (algo, CScript ());
+  if (newBlock == nullptr)
+    throw JSONRPCError (RPC_OUT_OF_MEMORY, "out of memory");
+
+  res.block = std::make_shared<const CBlock> (std::move (newBlock->block));
+  res.pindexPrev = chainman.ActiveTip ();
+  res.created = GetTime ();
+
+  return res;
+}
+
+void
+AuxpowMiner::setTip (const CBlockIndex* tip)
 {
   AssertLockHeld (cs);
-  const CBlock* pblockCur = nullptr;
+
+  if (tip == pindexPrev)
+    return;
+
+  /* Remember who mined on the old tip, so that they can get new work
+     pushed.  Then clear old blocks since they're obsolete now.  */
+  previousScripts.clear ();
+  for (const auto& entry : curBlocks)
+    previousScripts[entry.first.first].push_back (
+        entry.second->block->vtx[0]->vout[0].scriptPubKey);
+
+  baseTemplates.clear ();
+  blocks.clear ();
+  curBlocks.clear ();
+  savedBlocks.clear ();
+  pindexPrev = tip;
+}
+
+const AuxpowMiner::BaseTemplate&
+AuxpowMiner::installBaseTemplate (const PowAlgo algo, BaseTemplate&& base)
+{
+  AssertLockHeld (cs);
+  assert (base.pindexPrev == pindexPrev);
+
+  base.id = nextTemplateId++;
+  BaseTemplate& res = baseTemplates[algo] = std::move (base);
 
   {
-    LOCK (cs_main);
-    CScriptID scriptID (scriptPubKey);
-    auto iter = curBlocks.find (std::make_pair(algo, scriptID));
-    if (iter != curBlocks.end())
-      pblockCur = iter->second;
-
-    if (pblockCur == nullptr
-        || pindexPrev != chainman.ActiveChain ().Tip ()
-        || (mempool.GetTransactionsUpdated () != txUpdatedLast
-            && GetTime () - startTime > 60))
+    LOCK (csWork);
+    ++workSeq;
+  }
+  cvWork.notify_all ();
+
+  return res;
+}
+
+bool
+AuxpowMiner::needsRebuild (const BaseTemplate& base, const CTxMemPool& mempool)
+{
+  return mempool.GetTransactionsUpdated () != base.txUpdated
+            && GetTime () - base.created > 60;
+}
+
+void
+AuxpowMiner::requestRebuild (const PowAlgo algo)
+{
+  {
+    LOCK (csWorker);
+    rebuildQueue.insert (algo);
+  }
+  cvWorker.notify_one ();
+}
+
+void
+AuxpowMiner::rebuildBaseTemplate (const ChainstateManager& chainman,
+                                  const CTxMemPool& mempool,
+                                  const PowAlgo algo)
+{
+  AssertLockNotHeld (cs);
+
+  /* The rebuild may have been queued more than once, or the template may
+     have been replaced for a new tip in the mean time.  */
+  {
+    LOCK (cs);
+    const auto mit = baseTemplates.find (algo);
+    if (mit == baseTemplates.end () || !needsRebuild (mit->second, mempool))
+      return;
+  }
+
+  BaseTemplate base;
+  try
+    {
+      base = createBaseTemplate (chainman, mempool, algo);
+    }
+  catch (...)
+    {
+      LogPrintf ("Failed to rebuild auxpow block template\n");
+    }
+
+  std::vector<UniValue> work;
+  {
+    LOCK (cs);
+
+    /* If the tip changed in the mean time, the template is obsolete.  The
+       next request will then build one synchronously anyway.  */
+    if (base.block == nullptr || base.pindexPrev != pindexPrev
+          || base.pindexPrev != WITH_LOCK (cs_main,
+                                           return chainman.ActiveTip ()))
+      return;
+
+    /* The new template is only used if it pays more than the old one.
+       Otherwise we keep the old one (and thus its long-poll ID), so that
+       neither long-polling clients nor listeners are woken up for work
+       that is not better.  The old one is then considered up to date
+       with the mempool, so that we do not rebuild again right away.  */
+    const auto mit = baseTemplates.find (algo);
+    if (mit != baseTemplates.end ()
+          && base.block->vtx[0]->vout[0].nValue
+                <= mit->second.block->vtx[0]->vout[0].nValue)
       {
-        if (pindexPrev != chainman.ActiveChain ().Tip ())
-          {
-            /* Clear old blocks since they're obsolete now.  */
-            blocks.clear ();
-            templates.clear ();
-            curBlocks.clear ();
-          }
+        mit->second.txUpdated = base.txUpdated;
+        mit->second.created = base.created;
+        return;
+      }
+
+    const BaseTemplate& installed = installBaseTemplate (algo, std::move (base));
+    if (!hasListeners ())
+      return;
 
-        /* Create new block with nonce = 0 and extraNonce = 1.  */
-        std::unique_ptr<CBlockTemplate> newBlock
-            = BlockAssembler (chainman.ActiveChainstate (), mempool, Params ())
-                .CreateNewBlock (algo, scriptPubKey);
-        if (newBlock == nullptr)
-          throw JSONRPCError (RPC_OUT_OF_MEMORY, "out of memory");
-
-        /* Update state only when CreateNewBlock succeeded.  */
-        txUpdatedLast = mempool.GetTransactionsUpdated ();
-        pindexPrev = chainman.ActiveTip ();
-        startTime = GetTime ();
-
-        /* Finalise it by building the merkle root.  */
-        IncrementExtraNonce (&newBlock->block, pindexPrev, extraNonce);
-
-        /* Save in our map of constructed blocks.  */
-        pblockCur = &newBlock->block;
-        curBlocks.emplace (std::make_pair (algo, scriptID), pblockCur);
-        blocks[pblockCur->GetHash ()] = pblockCur;
-        templates.push_back (std::move (newBlock));
+    std::vector<CScript> scripts;
+    for (const auto& entry : curBlocks)
+      if (entry.first.first == algo)
+        scripts.push_back (entry.second->block->vtx[0]->vout[0].scriptPubKey);
+
+    for (const auto& script : scripts)
+      {
+        const CBlock* pblock = getPersonalisedBlock (installed, algo, script);
+        work.push_back (AddPayoutAddress (
+            getBlockJson (chainman, *pblock, GetBlockTarget (*pblock)),
+            *pblock));
       }
   }
 
-  /* At this point, pblockCur is always initialised:  If we make it here
-     without creating a new block above, it means that, in particular,
-     pindexPrev == ::ChainActive ().Tip().  But for that to happen, we must
-     already have created a pblockCur in a previous call, as pindexPrev is
-     initialised only when pblockCur is.  */
-  assert (pblockCur);
+  notifyListeners (work);
+}
 
-  arith_uint256 arithTarget;
-  bool fNegative, fOverflow;
-  arithTarget.SetCompact (pblockCur->pow.getBits (), &fNegative, &fOverflow);
-  if (fNegative || fOverflow || arithTarget == 0)
-    throw std::runtime_error ("invalid difficulty bits in block");
-  target = ArithToUint256 (arithTarget);
+const AuxpowMiner::BaseTemplate&
+AuxpowMiner::getBaseTemplate (const ChainstateManager& chainman,
+                              const CTxMemPool& mempool, const PowAlgo algo)
+{
+  AssertLockHeld (cs);
+
+  requestedAlgos.insert (algo);
+  setTip (WITH_LOCK (cs_main, return chainman.ActiveTip ()));
+
+  const auto mit = baseTemplates.find (algo);
+  if (mit != baseTemplates.end ())
+    {
+      const BaseTemplate& base = mit->second;
+      if (!needsRebuild (base, mempool))
+        return base;
+
+      /* Enough changed to warrant a new template, but the current one is
+         still valid.  Keep serving it until the rebuild is done.  */
+      if (workerThread.joinable ())
+        {
+          requestRebuild (algo);
+          return base;
+        }
+    }
+
+  BaseTemplate base = createBaseTemplate (chainman, mempool, algo);
+
+  /* Update state only when CreateNewBlock succeeded.  If the tip changed
+     just now, start over for the new one.  */
+  if (base.pindexPrev != pindexPrev)
+    return getBaseTemplate (chainman, mempool, algo);
+
+  return installBaseTemplate (algo, std::move (base));
+}
+
+const CBlock*
+AuxpowMiner::getPersonalisedBlock (const BaseTemplate& base, const PowAlgo algo,
+                                   const CScript& scriptPubKey)
+{
+  AssertLockHeld (cs);
+
+  const BlockKey key(algo, CScriptID (scriptPubKey));
+  auto iter = curBlocks.find (key);
+  if (iter != curBlocks.end () && iter->second->base == base.block)
+    {
+      savedBlocks.splice (savedBlocks.begin (), savedBlocks, iter->second);
+      return iter->second->block.get ();
+    }
+
+  /* Personalise the base template by swapping in the payout script and
+     finalise it by building the merkle root.  */
+  std::unique_ptr<CBlock> newBlock = std::make_unique<CBlock> (*base.block);
+  CMutableTransaction coinbase(*newBlock->vtx[0]);
+  coinbase.vout[0].scriptPubKey = scriptPubKey;
+  newBlock->vtx[0] = MakeTransactionRef (std::move (coinbase));
+  IncrementExtraNonce (newBlock.get (), pindexPrev, extraNonce);
+
+  /* Save in our map of constructed blocks.  */
+  const uint256 hash = newBlock->GetHash ();
+  savedBlocks.push_front ({std::move (newBlock), key, base.block});
+  blocks[hash] = savedBlocks.begin ();
+  curBlocks[key] = savedBlocks.begin ();
+
+  while (savedBlocks.size () > maxSavedBlocks)
+    {
+      const SavedBlock& oldest = savedBlocks.back ();
+      blocks.erase (oldest.block->GetHash ());
+      auto cit = curBlocks.find (oldest.key);
+      if (cit != curBlocks.end () && cit->second == std::prev (savedBlocks.end ()))
+        curBlocks.erase (cit);
+      savedBlocks.pop_back ();
+    }
+
+  return savedBlocks.front ().block.get ();
+}
+
+const CBlock*
+AuxpowMiner::getCurrentBlock (const ChainstateManager& chainman,
+                              const CTxMemPool& mempool, const PowAlgo algo,
+                              const CScript& scriptPubKey, uint256& target)
+{
+  AssertLockHeld (cs);
+
+  const BaseTemplate& base = getBaseTemplate (chainman, mempool, algo);
+  const CBlock* pblockCur = getPersonalisedBlock (base, algo, scriptPubKey);
+  target = GetBlockTarget (*pblockCur);
 
   return pblockCur;
 }
@@ -124,68 +376,117 @@ AuxpowMiner::lookupSavedBlock (const std::string& hashHex) const
   if (iter == blocks.end ())
     throw JSONRPCError (RPC_INVALID_PARAMETER, "block hash unknown");
 
-  return iter->second;
+  return iter->second->block.get ();
 }
 
-UniValue
-AuxpowMiner::createAuxBlock (const JSONRPCRequest& request,
-                             const CScript& scriptPubKey)
+std::string
+AuxpowMiner::getLongPollId (const ChainstateManager& chainman,
+                            const PowAlgo algo)
 {
-  auxMiningCheck (request);
-  LOCK (cs);
+  AssertLockHeld (cs);
 
-  const auto& node = EnsureAnyNodeContext (request.context);
-  const auto& mempool = EnsureMemPool (node);
-  const auto& chainman = EnsureChainman (node);
+  const CBlockIndex* tip = WITH_LOCK (cs_main, return chainman.ActiveTip ());
+  std::string res = tip->GetBlockHash ().GetHex ();
+  if (tip != pindexPrev)
+    return res;
 
-  uint256 target;
-  const CBlock* pblock = getCurrentBlock (chainman, mempool,
-                                          PowAlgo::SHA256D,
-                                          scriptPubKey, target);
+  const auto mit = baseTemplates.find (algo);
+  if (mit != baseTemplates.end ())
+    res += ToString (mit->second.id);
+
+  return res;
+}
+
+void
+AuxpowMiner::waitForNewWork (const ChainstateManager& chainman,
+                             const PowAlgo algo, const std::string& longpollid)
+{
+  AssertLockNotHeld (cs);
+
+  while (true)
+    {
+      const uint64_t seq = WITH_LOCK (csWork, return workSeq);
+      if (WITH_LOCK (cs, return getLongPollId (chainman, algo)) != longpollid)
+        return;
+
+      /* New tips and templates wake us up right away if notifications are
+         started.  Otherwise we notice a new tip through the timeout.  */
+      {
+        WAIT_LOCK (csWork, lock);
+        cvWork.wait_for (lock, std::chrono::seconds {1},
+                         [this, seq] () EXCLUSIVE_LOCKS_REQUIRED (csWork)
+          {
+            return workSeq != seq;
+          });
+      }
+
+      if (!IsRPCRunning ())
+        throw JSONRPCError (RPC_CLIENT_NOT_CONNECTED, "Shutting down");
+    }
+}
+
+UniValue
+AuxpowMiner::getBlockJson (const ChainstateManager& chainman,
+                           const CBlock& block, const uint256& target)
+{
+  AssertLockHeld (cs);
+
+  const PowAlgo algo = block.pow.getCoreAlgo ();
 
   UniValue result(UniValue::VOBJ);
-  result.pushKV ("hash", pblock->GetHash ().GetHex ());
-  result.pushKV ("algo", PowAlgoToString (pblock->pow.getCoreAlgo ()));
-  result.pushKV ("chainid", Params ().GetConsensus ().nAuxpowChainId);
-  result.pushKV ("previousblockhash", pblock->hashPrevBlock.GetHex ());
+  result.pushKV ("hash", block.GetHash ().GetHex ());
+  if (algo == PowAlgo::NEOSCRYPT)
+    result.pushKV ("data", HexStr (GetWorkData (block)));
+  result.pushKV ("algo", PowAlgoToString (algo));
+  if (algo == PowAlgo::SHA256D)
+    result.pushKV ("chainid", Params ().GetConsensus ().nAuxpowChainId);
+  result.pushKV ("previousblockhash", block.hashPrevBlock.GetHex ());
   result.pushKV ("coinbasevalue",
-                 static_cast<int64_t> (pblock->vtx[0]->vout[0].nValue));
-  result.pushKV ("bits", strprintf ("%08x", pblock->pow.getBits ()));
+                 static_cast<int64_t> (block.vtx[0]->vout[0].nValue));
+  result.pushKV ("bits", strprintf ("%08x", block.pow.getBits ()));
   result.pushKV ("height", static_cast<int64_t> (pindexPrev->nHeight + 1));
-  result.pushKV ("_target", HexStr (target));
+  result.pushKV (algo == PowAlgo::SHA256D ? "_target" : "target",
+                 HexStr (target));
+  result.pushKV ("longpollid", getLongPollId (chainman, algo));
 
   return result;
 }
 
-namespace
+UniValue
+AuxpowMiner::createAuxBlock (const JSONRPCRequest& request,
+                             const CScript& scriptPubKey,
+                             const std::string& longpollid)
 {
+  auxMiningCheck (request);
 
-// Copied from the diff in https://github.com/bitcoin/bitcoin/pull/4100.
-int
-FormatHashBlocks(void* pbuffer, unsigned int len)
-{
-    unsigned char* pdata = (unsigned char*)pbuffer;
-    unsigned int blocks = 1 + ((len + 8) / 64);
-    unsigned char* pend = pdata + 64 * blocks;
-    memset(pdata + len, 0, 64 * blocks - len);
-    pdata[len] = 0x80;
-    unsigned int bits = len * 8;
-    pend[-1] = (bits >> 0) & 0xff;
-    pend[-2] = (bits >> 8) & 0xff;
-    pend[-3] = (bits >> 16) & 0xff;
-    pend[-4] = (bits >> 24) & 0xff;
-    return blocks;
-}
+  const auto& node = EnsureAnyNodeContext (request.context);
+  const auto& mempool = EnsureMemPool (node);
+  const auto& chainman = EnsureChainman (node);
 
-}  // anonymous namespace
+  if (!longpollid.empty ())
+    waitForNewWork (chainman, PowAlgo::SHA256D, longpollid);
+
+  LOCK (cs);
+
+  uint256 target;
+  const CBlock* pblock = getCurrentBlock (chainman, mempool, PowAlgo::SHA256D,
+                                          scriptPubKey, target);
+
+  return getBlockJson (chainman, *pblock, target);
+}
 
 UniValue
 AuxpowMiner::createWork (const JSONRPCRequest& request,
-                         const CScript& scriptPubKey)
+                         const CScript& scriptPubKey,
+                         const std::string& longpollid)
 {
   auxMiningCheck (request);
   auto& node = EnsureAnyNodeContext (request.context);
   auto& chainman = EnsureChainman (node);
+
+  if (!longpollid.empty ())
+    waitForNewWork (chainman, PowAlgo::NEOSCRYPT, longpollid);
+
   LOCK (cs);
 
   const auto& mempool = EnsureMemPool (node);
@@ -195,33 +496,7 @@ AuxpowMiner::createWork (const JSONRPCRequest& request,
                                           PowAlgo::NEOSCRYPT,
                                           scriptPubKey, target);
 
-  CPureBlockHeader fakeHeader;
-  fakeHeader.SetNull ();
-  fakeHeader.hashMerkleRoot = pblock->GetHash ();
-
-  /* To construct the data result, we first have to serialise the template
-     fake header of the PoW data.  Then perform the byte-order swapping and
-     add zero-padding up to 128 bytes.  */
-  std::vector<unsigned char> data;
-  CVectorWriter writer(SER_GETHASH, PROTOCOL_VERSION, data, 0);
-  writer << fakeHeader;
-  const size_t len = data.size ();
-  data.resize (128, 0);
-  FormatHashBlocks (&data[0], len);
-  SwapGetWorkEndianness (data);
-
-  UniValue result(UniValue::VOBJ);
-  result.pushKV ("hash", pblock->GetHash ().GetHex ());
-  result.pushKV ("data", HexStr (data));
-  result.pushKV ("algo", PowAlgoToString (pblock->pow.getCoreAlgo ()));
-  result.pushKV ("previousblockhash", pblock->hashPrevBlock.GetHex ());
-  result.pushKV ("coinbasevalue",
-                 static_cast<int64_t> (pblock->vtx[0]->vout[0].nValue));
-  result.pushKV ("bits", strprintf ("%08x", pblock->pow.getBits ()));
-  result.pushKV ("height", static_cast<int64_t> (pindexPrev->nHeight + 1));
-  result.pushKV ("target", HexStr (target));
-
-  return result;
+  return getBlockJson (chainman, *pblock, target);
 }
 
 bool
@@ -288,6 +563,200 @@ AuxpowMiner::submitWork (const JSONRPCRequest& request,
   return chainman.ProcessNewBlock (Params (), shared_block, true, nullptr);
 }
 
+std::vector<UniValue>
+AuxpowMiner::prepareTipWork (const ChainstateManager& chainman,
+                             const CTxMemPool& mempool)
+{
+  AssertLockNotHeld (cs);
+
+  const std::set<PowAlgo> algos = WITH_LOCK (cs, return requestedAlgos);
+
+  std::vector<UniValue> work;
+  for (const PowAlgo algo : algos)
+    {
+      /* Reuse the template if a request has built it already.  */
+      bool needBuild;
+      {
+        LOCK (cs);
+        setTip (WITH_LOCK (cs_main, return chainman.ActiveTip ()));
+        needBuild = (baseTemplates.count (algo) == 0);
+      }
+
+      BaseTemplate base;
+      if (needBuild)
+        try
+          {
+            base = createBaseTemplate (chainman, mempool, algo);
+          }
+        catch (...)
+          {
+            LogPrintf ("Failed to build auxpow block template\n");
+            continue;
+          }
+
+      LOCK (cs);
+
+      /* If yet another tip arrived, work will be prepared for it when
+         its notification is processed.  */
+      if (WITH_LOCK (cs_main, return chainman.ActiveTip ()) != pindexPrev)
+        break;
+
+      /* Keep a template that a request built in the mean time, so that the
+         work it handed out stays current.  */
+      const BaseTemplate* installed;
+      const auto mit = baseTemplates.find (algo);
+      if (mit != baseTemplates.end ())
+        installed = &mit->second;
+      else if (base.block != nullptr && base.pindexPrev == pindexPrev)
+        installed = &installBaseTemplate (algo, std::move (base));
+      else
+        continue;
+
+      for (const auto& script : previousScripts[algo])
+        {
+          const CBlock* pblock = getPersonalisedBlock (*installed, algo,
+                                                       script);
+          work.push_back (AddPayoutAddress (
+              getBlockJson (chainman, *pblock, GetBlockTarget (*pblock)),
+              *pblock));
+        }
+    }
+
+  return work;
+}
+
+void
+AuxpowMiner::UpdatedBlockTip (const CBlockIndex* pindexNew,
+                              const CBlockIndex* pindexFork,
+                              const bool fInitialDownload)
+{
+  if (fInitialDownload || notifyChainman == nullptr)
+    return;
+
+  /* Building templates ahead of time is only worth it if someone is
+     actually mining, i.e. work has been requested before.  */
+  if (WITH_LOCK (cs, return requestedAlgos.empty ()))
+    return;
+
+  {
+    LOCK (csWorker);
+    tipPending = true;
+  }
+  cvWorker.notify_one ();
+}
+
+void
+AuxpowMiner::TransactionAddedToMempool (const CTransactionRef& tx,
+                                        const uint64_t mempool_sequence)
+{
+  if (notifyChainman == nullptr)
+    return;
+
+  /* Without this, templates would only be refreshed when miners poll for
+     work.  Those who rely on notifications get better templates pushed.  */
+  LOCK (cs);
+  for (const auto& entry : baseTemplates)
+    if (needsRebuild (entry.second, *notifyMempool))
+      requestRebuild (entry.first);
+}
+
+void
+AuxpowMiner::runWorker ()
+{
+  while (true)
+    {
+      bool tip;
+      std::set<PowAlgo> rebuilds;
+      {
+        WAIT_LOCK (csWorker, lock);
+        cvWorker.wait (lock, [this] () EXCLUSIVE_LOCKS_REQUIRED (csWorker)
+          {
+            return stopWorker || tipPending || !rebuildQueue.empty ();
+          });
+        if (stopWorker)
+          return;
+
+        tip = tipPending;
+        tipPending = false;
+        rebuilds.swap (rebuildQueue);
+      }
+
+      /* Work for a new tip comes first.  Rebuilds queued for the old tip
+         are then skipped, since the templates are fresh.  */
+      if (tip)
+        notifyListeners (prepareTipWork (*notifyChainman, *notifyMempool));
+      for (const PowAlgo algo : rebuilds)
+        rebuildBaseTemplate (*notifyChainman, *notifyMempool, algo);
+    }
+}
+
+void
+AuxpowMiner::notifyListeners (const std::vector<UniValue>& work)
+{
+  if (work.empty ())
+    return;
+
+  LOCK (csListeners);
+  for (const auto& listener : listeners)
+    for (const auto& w : work)
+      listener (w);
+}
+
+bool
+AuxpowMiner::hasListeners ()
+{
+  LOCK (csListeners);
+  return !listeners.empty ();
+}
+
+void
+AuxpowMiner::startNotifications (const ChainstateManager& chainman,
+                                 const CTxMemPool& mempool)
+{
+  assert (notifyChainman == nullptr);
+  notifyChainman = &chainman;
+  notifyMempool = &mempool;
+  workerThread = std::thread (&util::TraceThread, "auxminer",
+                              [this] () { runWorker (); });
+  RegisterValidationInterface (this);
+}
+
+void
+AuxpowMiner::stopNotifications ()
+{
+  if (notifyChainman == nullptr)
+    return;
+
+  UnregisterValidationInterface (this);
+
+  {
+    LOCK (csWorker);
+    stopWorker = true;
+  }
+  cvWorker.notify_one ();
+  workerThread.join ();
+
+  {
+    LOCK (csWorker);
+    stopWorker = false;
+    tipPending = false;
+    rebuildQueue.clear ();
+  }
+
+  notifyChainman = nullptr;
+  notifyMempool = nullptr;
+
+  LOCK (csListeners);
+  listeners.clear ();
+}
+
+void
+AuxpowMiner::addWorkListener (WorkListener listener)
+{
+  LOCK (csListeners);
+  listeners.push_back (std::move (listener));
+}
+
 AuxpowMiner&
 AuxpowMiner::get ()
 {
@@ -14,10 +14,16 @@
 #include <txmempool.h>
 #include <uint256.h>
 #include <univalue.h>
+#include <validationinterface.h>
 
+#include <condition_variable>
+#include <functional>
+#include <list>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -33,33 +39,194 @@ class AuxpowMinerForTest;
  * mining RPCs and the map of already constructed blocks to look them up
  * in the submitauxblock RPC.
  *
+ * For each algo, a single base template is built with BlockAssembler.  The
+ * blocks handed out to miners are derived from it by only swapping in the
+ * requested payout script and recomputing the merkle root, so that serving
+ * many payout scripts is cheap.  The handed-out blocks are kept in a store
+ * that is bounded by evicting the least recently used ones.
+ *
+ * Miners can wait for new work either by long-polling with the longpollid
+ * of their last work, or by registering as work listeners (e.g. the
+ * -zmqpubauxwork notifier).  For this, the miner follows tip updates
+ * once started:  On a dedicated worker thread, it prebuilds the base
+ * templates for each new tip (for the algos that work has been requested
+ * for before) and hands out work for the payout scripts that were mined
+ * to before.  Template rebuilds due to mempool changes are done on the
+ * worker thread as well, so that neither requests nor the validation
+ * interface callbacks have to wait for them.
+ *
  * It is used as a singleton that is initialised during startup, taking the
  * place of the previously real global and static variables.
  */
-class AuxpowMiner
+class AuxpowMiner : public CValidationInterface
 {
 
+public:
+
+  /** Default bound on the number of blocks kept for submission.  */
+  static constexpr size_t DEFAULT_MAX_SAVED_BLOCKS = 1000;
+
+  /**
+   * Callback for new work.  The argument is the same JSON object as
+   * returned by createauxblock or creatework, with the payout address
+   * added as "address".
+   */
+  using WorkListener = std::function<void (const UniValue& work)>;
+
 private:
 
+  /** Key for the current block per algo and payout script.  */
+  using BlockKey = std::pair<PowAlgo, CScriptID>;
+
+  /** A base template from which the blocks for each payout script are made.  */
+  struct BaseTemplate
+  {
+    /** The template block, paying to an empty script.  */
+    std::shared_ptr<const CBlock> block;
+    /** The tip the block builds on.  */
+    const CBlockIndex* pindexPrev = nullptr;
+    /** The mempool's transaction-update counter when it was built.  */
+    unsigned txUpdated = 0;
+    /** The time at which it was built.  */
+    int64_t created = 0;
+    /** Unique ID of the template, used for the longpollid.  */
+    uint64_t id = 0;
+  };
+
+  /** A block that has been handed out to miners.  */
+  struct SavedBlock
+  {
+    std::unique_ptr<const CBlock> block;
+    /** The algo and payout script it was made for.  */
+    BlockKey key;
+    /** The base template block it is derived from.  */
+    std::shared_ptr<const CBlock> base;
+  };
+
+  using SavedBlockList = std::list<SavedBlock>;
+
   /** The lock used for state in this object.  */
   mutable RecursiveMutex cs;
-  /** All currently "active" block templates.  */
-  std::vector<std::unique_ptr<CBlockTemplate>> templates;
-  /** Maps block hashes to pointers in vTemplates.  Does not own the memory.  */
-  std::map<uint256, const CBlock*> blocks;
-  /**
-   * Maps coinbase script hashes and PoW algorithms to pointers in vTemplates.
-   * Does not own the memory.
-   */
-  std::map<std::pair<PowAlgo, CScriptID>, const CBlock*> curBlocks;
+
+  /** Maximum number of blocks kept in savedBlocks.  */
+  const size_t maxSavedBlocks;
+
+  /** The current base template for each algo.  */
+  std::map<PowAlgo, BaseTemplate> baseTemplates;
+  /** Algos for which work has been requested since startup.  */
+  std::set<PowAlgo> requestedAlgos;
+
+  /** All currently "active" blocks, the most recently handed out first.  */
+  SavedBlockList savedBlocks;
+  /** Maps block hashes to entries in savedBlocks.  */
+  std::map<uint256, SavedBlockList::iterator> blocks;
+  /** Maps coinbase script hashes and PoW algorithms to entries in savedBlocks.  */
+  std::map<BlockKey, SavedBlockList::iterator> curBlocks;
 
   /** The current extra nonce for block creation.  */
   unsigned extraNonce = 0;
 
-  /* Some data about when the current block (pblock) was constructed.  */
-  unsigned txUpdatedLast;
+  /** The ID assigned to the next base template.  */
+  uint64_t nextTemplateId = 1;
+
+  /** The tip on which all saved blocks and base templates build.  */
   const CBlockIndex* pindexPrev = nullptr;
-  uint64_t startTime;
+
+  /**
+   * Payout scripts that work was handed out for at the previous tip.  They
+   * get new work pushed to the listeners when the next tip arrives.
+   */
+  std::map<PowAlgo, std::vector<CScript>> previousScripts;
+
+  /** Node state used to follow tip updates, if started.  */
+  const ChainstateManager* notifyChainman = nullptr;
+  const CTxMemPool* notifyMempool = nullptr;
+
+  /** Thread building templates in the background, if started.  */
+  std::thread workerThread;
+  /** Lock for the worker thread's queue.  */
+  Mutex csWorker;
+  /** Signalled when the worker thread has something to do.  */
+  std::condition_variable cvWorker;
+  /** Set when the worker thread should prepare work for a new tip.  */
+  bool tipPending GUARDED_BY (csWorker) = false;
+  /** Algos whose base template the worker thread should rebuild.  */
+  std::set<PowAlgo> rebuildQueue GUARDED_BY (csWorker);
+  /** Set when the worker thread should exit.  */
+  bool stopWorker GUARDED_BY (csWorker) = false;
+
+  /** Lock for the registered listeners.  */
+  Mutex csListeners;
+  /** Listeners that are notified about new work.  */
+  std::vector<WorkListener> listeners GUARDED_BY (csListeners);
+
+  /** Lock for waking up long-polling requests.  */
+  Mutex csWork;
+  /** Signalled whenever new work is available.  */
+  std::condition_variable cvWork;
+  /** Counter incremented whenever cvWork is signalled.  */
+  uint64_t workSeq GUARDED_BY (csWork) = 0;
+
+  /**
+   * Switches to the given tip.  If it differs from the current one, all
+   * blocks and templates are dropped since they are obsolete.
+   */
+  void setTip (const CBlockIndex* tip) EXCLUSIVE_LOCKS_REQUIRED (cs);
+
+  /**
+   * Installs a newly built base template for the given algo and returns
+   * a reference to it.  Long-polling requests are woken up.
+   */
+  const BaseTemplate& installBaseTemplate (PowAlgo algo, BaseTemplate&& base)
+      EXCLUSIVE_LOCKS_REQUIRED (cs);
+
+  /** Queues a rebuild of the base template for the algo on the worker.  */
+  void requestRebuild (PowAlgo algo) LOCKS_EXCLUDED (csWorker);
+
+  /**
+   * Returns true if the base template is old enough and the mempool
+   * changed, so that it should be rebuilt.
+   */
+  static bool needsRebuild (const BaseTemplate& base,
+                            const CTxMemPool& mempool);
+
+  /**
+   * Builds a new base template for the given algo on top of the current
+   * tip.  This locks cs_main, but does not need cs.
+   */
+  static BaseTemplate createBaseTemplate (const ChainstateManager& chainman,
+                                          const CTxMemPool& mempool,
+                                          PowAlgo algo);
+
+  /**
+   * Rebuilds the base template for the given algo and installs it if it
+   * still builds on the current tip and pays more than the current one.
+   * This is run on the worker thread.
+   */
+  void rebuildBaseTemplate (const ChainstateManager& chainman,
+                            const CTxMemPool& mempool, PowAlgo algo)
+      LOCKS_EXCLUDED (cs);
+
+  /**
+   * Returns the base template for the given algo.  If the tip changed, all
+   * old blocks are dropped and the template is built right away (unless
+   * the worker thread prebuilt it already).  If only the mempool changed
+   * enough, the existing template is returned and a rebuild is queued on
+   * the worker thread.  Without the worker thread (e.g. when notifications
+   * are not started), the rebuild is done synchronously instead.
+   */
+  const BaseTemplate& getBaseTemplate (const ChainstateManager& chainman,
+                                       const CTxMemPool& mempool,
+                                       PowAlgo algo)
+      EXCLUSIVE_LOCKS_REQUIRED (cs);
+
+  /**
+   * Returns the block derived from the given base template for the payout
+   * script, constructing and saving it if necessary.
+   */
+  const CBlock* getPersonalisedBlock (const BaseTemplate& base, PowAlgo algo,
+                                      const CScript& scriptPubKey)
+      EXCLUSIVE_LOCKS_REQUIRED (cs);
 
   /**
    * Constructs a new current block if necessary (checking the current state to
@@ -68,8 +235,7 @@ private:
    * fills in the difficulty target value.
    */
   const CBlock* getCurrentBlock (const ChainstateManager& chainman,
-                                 const CTxMemPool& mempool,
-                                 PowAlgo algo,
+                                 const CTxMemPool& mempool, PowAlgo algo,
                                  const CScript& scriptPubKey, uint256& target)
       EXCLUSIVE_LOCKS_REQUIRED (cs);
 
@@ -80,11 +246,71 @@ private:
   const CBlock* lookupSavedBlock (const std::string& hashHex) const
       EXCLUSIVE_LOCKS_REQUIRED (cs);
 
+  /**
+   * Returns the longpollid for the current work of the given algo.  If
+   * there is no base template for the current tip yet, it is just the
+   * tip's block hash.
+   */
+  std::string getLongPollId (const ChainstateManager& chainman, PowAlgo algo)
+      EXCLUSIVE_LOCKS_REQUIRED (cs);
+
+  /**
+   * Blocks until the work of the given algo no longer matches longpollid,
+   * or throws if the RPC server is shutting down.
+   */
+  void waitForNewWork (const ChainstateManager& chainman, PowAlgo algo,
+                       const std::string& longpollid)
+      LOCKS_EXCLUDED (cs);
+
+  /**
+   * Returns the JSON data about a block handed out to miners, as returned
+   * by createauxblock or creatework depending on the algo.
+   */
+  UniValue getBlockJson (const ChainstateManager& chainman, const CBlock& block,
+                         const uint256& target)
+      EXCLUSIVE_LOCKS_REQUIRED (cs);
+
+  /**
+   * Builds (if necessary) the base template of each requested algo for the
+   * current tip and returns the work for all payout scripts in
+   * previousScripts.
+   */
+  std::vector<UniValue> prepareTipWork (const ChainstateManager& chainman,
+                                        const CTxMemPool& mempool)
+      LOCKS_EXCLUDED (cs);
+
+  /** Main loop of the worker thread.  */
+  void runWorker () LOCKS_EXCLUDED (cs, csWorker);
+
+  /** Calls all registered listeners with each of the given work.  */
+  void notifyListeners (const std::vector<UniValue>& work)
+      LOCKS_EXCLUDED (csListeners);
+
+  /** Returns true if any listeners are registered.  */
+  bool hasListeners () LOCKS_EXCLUDED (csListeners);
+
   friend class auxpow_tests::AuxpowMinerForTest;
 
+protected:
+
+  void UpdatedBlockTip (const CBlockIndex* pindexNew,
+                        const CBlockIndex* pindexFork,
+                        bool fInitialDownload) override;
+  void TransactionAddedToMempool (const CTransactionRef& tx,
+                                  uint64_t mempool_sequence) override;
+
 public:
 
-  AuxpowMiner () = default;
+  explicit AuxpowMiner (size_t maxBlocks = DEFAULT_MAX_SAVED_BLOCKS)
+    : maxSavedBlocks(maxBlocks)
+  {
+    assert (maxSavedBlocks > 0);
+  }
+
+  ~AuxpowMiner ()
+  {
+    stopNotifications ();
+  }
 
   /**
    * Performs the main work for the "createauxblock" RPC:  Construct a new block
@@ -92,7 +318,8 @@ public:
    * necessary information for the miner to construct an auxpow for it.
    */
   UniValue createAuxBlock (const JSONRPCRequest& request,
-                           const CScript& scriptPubKey);
+                           const CScript& scriptPubKey,
+                           const std::string& longpollid = "");
 
   /**
    * Performs the main work for the "submitauxblock" RPC:  Look up the block
@@ -108,7 +335,8 @@ public:
    * Performs the main logic needed for the "create" form of the "getwork" RPC.
    */
   UniValue createWork (const JSONRPCRequest& request,
-                       const CScript& scriptPubKey);
+                       const CScript& scriptPubKey,
+                       const std::string& longpollid = "");
 
   /**
    * Performs the "submit" form of the "getwork" RPC.
@@ -117,6 +345,22 @@ public:
                    const std::string& hashHex,
                    const std::string& dataHex) const;
 
+  /**
+   * Starts following tip and mempool updates, so that new work is built
+   * ahead of time and pushed to the listeners.
+   */
+  void startNotifications (const ChainstateManager& chainman,
+                           const CTxMemPool& mempool);
+
+  /**
+   * Stops following updates, joins the worker thread and removes all
+   * listeners.
+   */
+  void stopNotifications ();
+
+  /** Registers a listener that is called whenever new work is available.  */
+  void addWorkListener (WorkListener listener);
+
   /**
    * Returns the singleton instance of AuxpowMiner that is used for RPCs.
    */
@@ -169,13 +169,18 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "upgradewallet", 0, "version" },
 
     { "name_show", 1, "options" },
+    { "name_showbyhashes", 0, "hashes" },
+    { "name_showbyhashes", 1, "options" },
     { "name_history", 1, "options" },
     { "name_scan", 1, "count" },
     { "name_scan", 2, "options" },
     { "name_pending", 1, "options" },
+    { "name_checkdb", 0, "incremental" },
     { "name_list", 1, "options" },
     { "name_register", 2, "options" },
     { "name_update", 2, "options" },
+    { "name_updatemany", 0, "updates" },
+    { "name_updatemany", 1, "options" },
     { "namerawtransaction", 1, "vout" },
     { "namerawtransaction", 2, "nameop" },
     { "namepsbt", 1, "vout" },
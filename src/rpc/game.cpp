@@ -6,13 +6,16 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <index/gamemoves.h>
 #include <logging.h>
+#include <names/mempool.h>
 #include <node/blockstorage.h>
 #include <random.h>
 #include <rpc/blockchain.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/script.h>
+#include <txmempool.h>
 #include <uint256.h>
 #include <util/strencodings.h>
 #include <util/system.h>
@@ -23,6 +26,8 @@
 
 #include <univalue.h>
 
+#include <algorithm>
+#include <optional>
 #include <sstream>
 
 namespace
@@ -82,42 +87,112 @@ SendUpdatesWorker::Work::str () const
   return res.str ();
 }
 
-SendUpdatesWorker::SendUpdatesWorker ()
-  : interrupted(false)
+/**
+ * The state of a game_sendupdates request while it is being processed.
+ * All mutable fields are guarded by the worker's csWork.
+ */
+struct SendUpdatesWorker::ActiveWork
 {
-  runner.reset (new std::thread ([this] ()
-    {
-      util::TraceThread ("sendupdates", [this] () { run (*this); });
-    }));
+
+  /** A single block for which notifications are sent.  */
+  struct Step
+  {
+    /** True for a detach and false for an attach notification.  */
+    bool detach;
+    const CBlockIndex* pindex;
+  };
+
+  /** The notifications prepared for a single step.  */
+  using PreparedStep = std::vector<ZMQGameBlocksNotifier::PreparedMessage>;
+
+  /** The request being processed.  */
+  const Work w;
+
+  /** All steps (detaches followed by attaches) in publishing order.  */
+  std::vector<Step> steps;
+
+  /** Notifications that are prepared but not yet published.  */
+  std::vector<std::optional<PreparedStep>> prepared;
+
+  /** Index of the next step to prepare.  */
+  size_t nextPrepare = 0;
+  /** Index of the next step to publish.  */
+  size_t nextPublish = 0;
+  /** Set while one of the threads is publishing for this request.  */
+  bool publishing = false;
+
+  explicit ActiveWork (Work&& wrk);
+
+};
+
+SendUpdatesWorker::ActiveWork::ActiveWork (Work&& wrk)
+  : w(std::move (wrk))
+{
+  for (const auto* pindex : w.detach)
+    steps.push_back ({true, pindex});
+  for (const auto* pindex : w.attach)
+    steps.push_back ({false, pindex});
+  prepared.resize (steps.size ());
+}
+
+SendUpdatesWorker::SendUpdatesWorker (const size_t numThreads,
+                                      const size_t ra, const bool bp)
+  : readAhead(std::max<size_t> (ra, 1)),
+    maxActive(std::max<size_t> (numThreads, 1)),
+    backpressure(bp),
+    interrupted(false)
+{
+  for (size_t i = 0; i < maxActive; ++i)
+    runners.emplace_back ([this, i] ()
+      {
+        const std::string name = strprintf ("sendupdates.%d", i);
+        util::TraceThread (name.c_str (), [this] () { run (*this); });
+      });
 }
 
 SendUpdatesWorker::~SendUpdatesWorker ()
 {
-  if (runner != nullptr && runner->joinable ())
-    runner->join ();
-  runner.reset ();
+  for (auto& t : runners)
+    if (t.joinable ())
+      t.join ();
+  runners.clear ();
 }
 
 namespace
 {
 
 #if ENABLE_ZMQ
-void
-SendUpdatesOneBlock (const std::set<std::string>& trackedGames,
-                     const std::string& commandPrefix,
-                     const std::string& reqtoken,
-                     const CBlockIndex* pindex)
+std::vector<ZMQGameBlocksNotifier::PreparedMessage>
+PrepareUpdatesOneBlock (const std::set<std::string>& trackedGames,
+                        const std::string& commandPrefix,
+                        const std::string& reqtoken,
+                        const CBlockIndex* pindex)
 {
+  auto* notifier = GetGameBlocksNotifier ();
+
+  /* If the game-move index is available and has the block already,
+     we can construct the notifications from it without reading and
+     parsing the full block from disk.  */
+  if (g_game_move_index != nullptr)
+    {
+      const auto data = g_game_move_index->FindBlockData (*pindex,
+                                                          trackedGames);
+      if (data != nullptr)
+        return notifier->PrepareBlockNotifications (trackedGames,
+                                                    commandPrefix, reqtoken,
+                                                    *pindex, *data);
+    }
+
   CBlock blk;
   if (!ReadBlockFromDisk (blk, pindex, Params ().GetConsensus ()))
     {
       LogPrint (BCLog::GAME, "Reading block %s failed, ignoring\n",
                 pindex->GetBlockHash ().GetHex ());
-      return;
+      return {};
     }
 
-  auto* notifier = GetGameBlocksNotifier ();
-  notifier->SendBlockNotifications (trackedGames, commandPrefix, reqtoken, blk);
+  return notifier->PrepareBlockNotifications (trackedGames, commandPrefix,
+                                              reqtoken, blk, *pindex);
 }
 #endif // ENABLE_ZMQ
 
@@ -127,45 +202,140 @@ void
 SendUpdatesWorker::run (SendUpdatesWorker& self)
 {
 #if ENABLE_ZMQ
+  WAIT_LOCK (self.csWork, lock);
   while (true)
     {
-      Work w;
-
-      {
-        WAIT_LOCK (self.csWork, lock);
-
-        if (self.work.empty ())
+      /* Start processing queued requests while there is room for them.  */
+      while (!self.work.empty () && self.active.size () < self.maxActive)
+        {
+          auto cur = std::make_shared<ActiveWork> (
+                        std::move (self.work.front ()));
+          self.work.pop ();
+
+          LogPrint (BCLog::GAME, "Popped for sendupdates processing: %s\n",
+                    cur->w.str ().c_str ());
+
+          if (cur->steps.empty ())
+            LogPrint (BCLog::GAME, "Finished processing sendupdates: %s\n",
+                      cur->w.str ().c_str ());
+          else
+            self.active.push_back (cur);
+        }
+
+      /* Find the next block to prepare, preferring older requests.  */
+      std::shared_ptr<ActiveWork> cur;
+      for (const auto& a : self.active)
+        if (a->nextPrepare < a->steps.size ()
+              && a->nextPrepare < a->nextPublish + self.readAhead)
           {
-            LogPrint (BCLog::GAME,
-                      "SendUpdatesWorker queue empty, interrupted = %d\n",
-                      self.interrupted);
+            cur = a;
+            break;
+          }
 
-            if (self.interrupted)
-              break;
+      if (cur == nullptr)
+        {
+          if (self.work.empty () && self.active.empty ())
+            {
+              LogPrint (BCLog::GAME,
+                        "SendUpdatesWorker queue empty, interrupted = %d\n",
+                        self.interrupted);
 
-            LogPrint (BCLog::GAME,
-                      "Waiting for sendupdates condition variable...\n");
-            self.cvWork.wait (lock);
-            continue;
-          }
+              if (self.interrupted)
+                break;
+            }
 
-        w = std::move (self.work.front ());
-        self.work.pop ();
+          LogPrint (BCLog::GAME,
+                    "Waiting for sendupdates condition variable...\n");
+          self.cvWork.wait (lock);
+          continue;
+        }
 
-        LogPrint (BCLog::GAME, "Popped for sendupdates processing: %s\n",
-                  w.str ().c_str ());
+      const size_t index = cur->nextPrepare++;
+      const auto& step = cur->steps[index];
+      ActiveWork::PreparedStep msgs;
+      {
+        REVERSE_LOCK (lock);
+        msgs = PrepareUpdatesOneBlock (cur->w.trackedGames,
+                                       step.detach
+                                         ? ZMQGameBlocksNotifier::PREFIX_DETACH
+                                         : ZMQGameBlocksNotifier::PREFIX_ATTACH,
+                                       cur->w.reqtoken, step.pindex);
       }
-
-      for (const auto* pindex : w.detach)
-        SendUpdatesOneBlock (w.trackedGames,
-                             ZMQGameBlocksNotifier::PREFIX_DETACH,
-                             w.reqtoken, pindex);
-      for (const auto* pindex : w.attach)
-        SendUpdatesOneBlock (w.trackedGames,
-                             ZMQGameBlocksNotifier::PREFIX_ATTACH,
-                             w.reqtoken, pindex);
-      LogPrint (BCLog::GAME, "Finished processing sendupdates: %s\n",
-                w.str ().c_str ());
+      cur->prepared[index] = std::move (msgs);
+
+      /* If another thread is already publishing for this request, it will
+         also pick up the step we just prepared.  */
+      if (cur->publishing)
+        continue;
+
+      cur->publishing = true;
+      while (cur->nextPublish < cur->steps.size ()
+               && cur->prepared[cur->nextPublish])
+        {
+          const auto msgs = std::move (*cur->prepared[cur->nextPublish]);
+          cur->prepared[cur->nextPublish].reset ();
+          if (self.backpressure)
+            {
+              /* Publish the messages as the subscribers accept them.  While
+                 we wait, the read-ahead window does not move, so that the
+                 other threads stop preparing more blocks as well.  If the
+                 subscribers make no progress for too long, we give up
+                 waiting so that a stuck subscriber cannot block the
+                 request (and the worker thread) forever.  */
+              size_t sent = 0;
+              auto deadline = std::chrono::steady_clock::now ()
+                                + SENDUPDATES_BACKPRESSURE_TIMEOUT;
+              while (true)
+                {
+                  size_t newSent;
+                  {
+                    REVERSE_LOCK (lock);
+                    newSent = GetGameBlocksNotifier ()
+                                ->TrySendPreparedNotifications (msgs, sent);
+                  }
+                  if (newSent > sent)
+                    deadline = std::chrono::steady_clock::now ()
+                                 + SENDUPDATES_BACKPRESSURE_TIMEOUT;
+                  sent = newSent;
+                  if (sent == msgs.size () || self.interrupted
+                        || std::chrono::steady_clock::now () >= deadline)
+                    break;
+                  self.cvWork.wait_for (lock, SENDUPDATES_BACKPRESSURE_WAIT);
+                }
+              if (sent < msgs.size () && self.interrupted)
+                LogPrint (BCLog::GAME,
+                          "Dropped %d sendupdates notifications on shutdown\n",
+                          msgs.size () - sent);
+              else if (sent < msgs.size ())
+                {
+                  LogPrint (BCLog::GAME,
+                            "Subscribers stalled, sending %d sendupdates"
+                            " notifications without backpressure\n",
+                            msgs.size () - sent);
+                  const std::vector<ZMQGameBlocksNotifier::PreparedMessage>
+                      rest(msgs.begin () + sent, msgs.end ());
+                  REVERSE_LOCK (lock);
+                  GetGameBlocksNotifier ()->SendPreparedNotifications (rest);
+                }
+            }
+          else
+            {
+              REVERSE_LOCK (lock);
+              GetGameBlocksNotifier ()->SendPreparedNotifications (msgs);
+            }
+          ++cur->nextPublish;
+        }
+      cur->publishing = false;
+
+      if (cur->nextPublish == cur->steps.size ())
+        {
+          LogPrint (BCLog::GAME, "Finished processing sendupdates: %s\n",
+                    cur->w.str ().c_str ());
+          self.active.remove (cur);
+        }
+
+      /* Publishing moved the read-ahead window, or the request is done.  */
+      self.cvWork.notify_all ();
     }
 #endif // ENABLE_ZMQ
 }
@@ -407,6 +577,54 @@ trackedgames ()
   );
 }
 
+} // anonymous namespace
+/* ************************************************************************** */
+namespace
+{
+
+RPCHelpMan
+game_pendingmoves ()
+{
+  return RPCHelpMan ("game_pendingmoves",
+      "\nReturns the moves for the given game that are currently pending in the mempool.\n"
+      "\nThis allows game daemons to get the pending state e.g. when they start, instead of relying on game-pending-move notifications only.\n",
+      {
+          {"gameid", RPCArg::Type::STR, RPCArg::Optional::NO, "The game ID for which to return pending moves"},
+      },
+      RPCResult {RPCResult::Type::ARR, "", "",
+          {
+              {RPCResult::Type::OBJ, "", "the move data, as in game-pending-move notifications",
+                  {
+                      {RPCResult::Type::ELISION, "", ""},
+                  }
+              },
+          }
+      },
+      RPCExamples {
+          HelpExampleCli ("game_pendingmoves", "\"huc\"")
+        + HelpExampleRpc ("game_pendingmoves", "\"huc\"")
+      },
+      [&] (const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+  RPCTypeCheck (request.params, {UniValue::VSTR});
+
+  const std::string& gameid = request.params[0].get_str ();
+  const auto& mempool = EnsureAnyMemPool (request.context);
+
+  /* Only the references to the transactions that may have moves for the
+     game are copied while holding the lock.  Decoding their moves is done
+     afterwards.  */
+  const auto txs = WITH_LOCK (mempool.cs, return mempool.getMoveTxs (gameid));
+
+  UniValue res(UniValue::VARR);
+  for (auto& move : GetPendingMoves (txs, gameid))
+    res.push_back (std::move (move));
+
+  return res;
+}
+  );
+}
+
 } // anonymous namespace
 /* ************************************************************************** */
 
@@ -415,6 +633,7 @@ void RegisterGameRPCCommands (CRPCTable& t)
 static const CRPCCommand commands[] =
 { //  category               actor (function)
   //  ---------------------  -----------------------
+  { "game",                  &game_pendingmoves,       },
   { "game",                  &game_sendupdates,        },
   { "game",                  &trackedgames,            },
 };
@@ -7,7 +7,9 @@
 
 #include <sync.h>
 
+#include <chrono>
 #include <condition_variable>
+#include <list>
 #include <memory>
 #include <queue>
 #include <set>
@@ -23,10 +25,49 @@ class CBlockIndex;
  */
 static constexpr unsigned DEFAULT_MAX_GAME_BLOCK_ATTACHES = 1000;
 
+/**
+ * Default value for the -sendupdatesthreads option, the number of threads
+ * used to read blocks and prepare notifications for game_sendupdates.
+ */
+static constexpr unsigned DEFAULT_SENDUPDATES_THREADS = 4;
+
+/**
+ * Default value for the -sendupdatesreadahead option, which determines how
+ * many blocks of a game_sendupdates request may be prepared ahead of the
+ * last one that has been published.
+ */
+static constexpr unsigned DEFAULT_SENDUPDATES_READAHEAD = 32;
+
+/**
+ * Default value for the -sendupdatesbackpressure option.  If enabled, the
+ * game-blocks ZMQ socket refuses messages when a subscriber's high water
+ * mark is reached, and game_sendupdates waits for the subscribers to catch
+ * up instead of letting ZMQ drop the notifications.
+ */
+static constexpr bool DEFAULT_SENDUPDATES_BACKPRESSURE = false;
+
+/**
+ * Time to wait before trying again to publish game_sendupdates notifications
+ * that were refused due to backpressure.
+ */
+static constexpr auto SENDUPDATES_BACKPRESSURE_WAIT = std::chrono::milliseconds{10};
+
+/**
+ * Time after which game_sendupdates stops waiting for subscribers that do
+ * not accept any notifications at all.  The remaining notifications of the
+ * block are then sent as without backpressure, i.e. dropped for subscribers
+ * that are still at their high water mark.
+ */
+static constexpr auto SENDUPDATES_BACKPRESSURE_TIMEOUT = std::chrono::seconds{10};
+
 /**
  * The worker for game_sendupdates.  It maintains a queue of work items to
- * process and has a thread that reads the items and performs the work.  It is
- * exposed publicly so that init.cpp can start/interrupt/stop as necessary.
+ * process and has a pool of threads that reads the items and performs the
+ * work.  Up to one request per thread is processed at the same time.
+ * For each of them, the blocks are read and their notifications prepared
+ * in parallel (up to the read-ahead limit), while the notifications are
+ * published strictly in order.  It is exposed publicly so that init.cpp
+ * can start/interrupt/stop as necessary.
  */
 class SendUpdatesWorker
 {
@@ -54,19 +95,33 @@ public:
 
 private:
 
+  /** State of a request that is currently being processed.  */
+  struct ActiveWork;
+
+  /** Number of blocks that may be prepared ahead of publishing.  */
+  const size_t readAhead;
+  /** Number of requests that may be processed at the same time.  */
+  const size_t maxActive;
+  /** Whether to wait for subscribers if the high water mark is reached.  */
+  const bool backpressure;
+
   std::queue<Work> work;
+  std::list<std::shared_ptr<ActiveWork>> active;
   bool interrupted;
 
   Mutex csWork;
   std::condition_variable cvWork;
 
-  std::unique_ptr<std::thread> runner;
+  std::vector<std::thread> runners;
 
   static void run (SendUpdatesWorker& self);
 
 public:
 
-  SendUpdatesWorker ();
+  explicit SendUpdatesWorker (
+      size_t numThreads = DEFAULT_SENDUPDATES_THREADS,
+      size_t ra = DEFAULT_SENDUPDATES_READAHEAD,
+      bool bp = DEFAULT_SENDUPDATES_BACKPRESSURE);
   ~SendUpdatesWorker ();
 
   SendUpdatesWorker (const SendUpdatesWorker&) = delete;
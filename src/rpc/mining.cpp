@@ -1323,9 +1323,12 @@ static RPCHelpMan createauxblock()
 {
     return RPCHelpMan{"createauxblock",
         "\nCreates a new block and returns information required to"
-        " merge-mine it.\n",
+        " merge-mine it.\n"
+        "\nIf a longpollid is given, waits until there is new work (a new tip"
+        " or a better block template) before returning.\n",
         {
             {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "Payout address for the coinbase transaction"},
+            {"longpollid", RPCArg::Type::STR, RPCArg::Optional::OMITTED_NAMED_ARG, "The longpollid of previous work to wait for an update of"},
         },
         RPCResult{
             RPCResult::Type::OBJ, "", "",
@@ -1338,10 +1341,12 @@ static RPCHelpMan createauxblock()
                 {RPCResult::Type::STR_HEX, "bits", "compressed target of the block"},
                 {RPCResult::Type::NUM, "height", "height of the block"},
                 {RPCResult::Type::STR_HEX, "_target", "target in reversed byte order, deprecated"},
+                {RPCResult::Type::STR, "longpollid", "an id to include with a request to longpoll on an update to this work"},
             },
         },
         RPCExamples{
           HelpExampleCli("createauxblock", "\"address\"")
+          + HelpExampleCli("createauxblock", "\"address\" \"longpollid\"")
           + HelpExampleRpc("createauxblock", "\"address\"")
         },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
@@ -1356,7 +1361,12 @@ static RPCHelpMan createauxblock()
     }
     const CScript scriptPubKey = GetScriptForDestination(coinbaseScript);
 
-    return AuxpowMiner::get ().createAuxBlock(request, scriptPubKey);
+    std::string longpollid;
+    if (!request.params[1].isNull())
+        longpollid = request.params[1].get_str();
+
+    return AuxpowMiner::get ().createAuxBlock(request, scriptPubKey,
+                                              longpollid);
 },
     };
 }
@@ -1389,9 +1399,12 @@ static RPCHelpMan submitauxblock()
 static RPCHelpMan creatework()
 {
     return RPCHelpMan{"creatework",
-        "\nCreates a new block and returns information required to mine it stand-alone.\n",
+        "\nCreates a new block and returns information required to mine it stand-alone.\n"
+        "\nIf a longpollid is given, waits until there is new work (a new tip"
+        " or a better block template) before returning.\n",
         {
             {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "Payout address for the coinbase transaction"},
+            {"longpollid", RPCArg::Type::STR, RPCArg::Optional::OMITTED_NAMED_ARG, "The longpollid of previous work to wait for an update of"},
         },
         RPCResult{
             RPCResult::Type::OBJ, "", "",
@@ -1404,10 +1417,12 @@ static RPCHelpMan creatework()
                 {RPCResult::Type::STR_HEX, "bits", "compressed target of the block"},
                 {RPCResult::Type::NUM, "height", "height of the block"},
                 {RPCResult::Type::STR_HEX, "target", "target in reversed byte order, deprecated"},
+                {RPCResult::Type::STR, "longpollid", "an id to include with a request to longpoll on an update to this work"},
             },
         },
         RPCExamples{
             HelpExampleCli("creatework", "\"address\"")
+          + HelpExampleCli("creatework", "\"address\" \"longpollid\"")
           + HelpExampleRpc("creatework", "\"address\"")
         },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
@@ -1421,7 +1436,11 @@ static RPCHelpMan creatework()
     }
     const CScript scriptPubKey = GetScriptForDestination(coinbaseScript);
 
-    return AuxpowMiner::get ().createWork(request, scriptPubKey);
+    std::string longpollid;
+    if (!request.params[1].isNull())
+        longpollid = request.params[1].get_str();
+
+    return AuxpowMiner::get ().createWork(request, scriptPubKey, longpollid);
 },
     };
 }
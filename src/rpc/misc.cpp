@@ -6,6 +6,7 @@
 #include <httpserver.h>
 #include <index/blockfilterindex.h>
 #include <index/coinstatsindex.h>
+#include <index/gamemoves.h>
 #include <index/namehash.h>
 #include <index/txindex.h>
 #include <interfaces/chain.h>
@@ -24,6 +25,7 @@
 #include <util/message.h> // For MessageSign(), MessageVerify()
 #include <util/strencodings.h>
 #include <util/system.h>
+#include <validation.h>
 
 #include <stdint.h>
 #include <tuple>
@@ -522,6 +524,11 @@ static RPCHelpMan getmemoryinfo()
                                 {RPCResult::Type::NUM, "chunks_used", "Number allocated chunks"},
                                 {RPCResult::Type::NUM, "chunks_free", "Number unused chunks"},
                             }},
+                            {RPCResult::Type::OBJ, "coins_cache", "Information about the in-memory cache of the chainstate",
+                            {
+                                {RPCResult::Type::NUM, "usage", "Total number of bytes used, including the name cache"},
+                                {RPCResult::Type::NUM, "names", "Number of bytes used by cached name changes"},
+                            }},
                         }
                     },
                     RPCResult{"mode \"mallocinfo\"",
@@ -538,6 +545,17 @@ static RPCHelpMan getmemoryinfo()
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+
+        ChainstateManager& chainman = EnsureAnyChainman(request.context);
+        UniValue coins(UniValue::VOBJ);
+        {
+            LOCK(cs_main);
+            const CCoinsViewCache& view = chainman.ActiveChainstate().CoinsTip();
+            coins.pushKV("usage", (uint64_t)view.DynamicMemoryUsage());
+            coins.pushKV("names", (uint64_t)view.NameCacheMemoryUsage());
+        }
+        obj.pushKV("coins_cache", coins);
+
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -758,6 +776,9 @@ static RPCHelpMan getindexinfo()
     if (g_name_hash_index) {
         result.pushKVs(SummaryToJSON(g_name_hash_index->GetSummary(), index_name));
     }
+    if (g_game_move_index) {
+        result.pushKVs(SummaryToJSON(g_game_move_index->GetSummary(), index_name));
+    }
 
     if (g_coin_stats_index) {
         result.pushKVs(SummaryToJSON(g_coin_stats_index->GetSummary(), index_name));
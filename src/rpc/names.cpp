@@ -18,9 +18,12 @@
 #include <rpc/names.h>
 #include <rpc/server.h>
 #include <script/names.h>
+#include <streams.h>
 #include <txmempool.h>
+#include <util/check.h>
 #include <util/strencodings.h>
 #include <validation.h>
+#include <version.h>
 #ifdef ENABLE_WALLET
 # include <wallet/rpcwallet.h>
 # include <wallet/wallet.h>
@@ -32,12 +35,106 @@
 
 #include <algorithm>
 #include <cassert>
+#include <limits>
+#include <map>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 
 namespace
 {
 
+/** Version of the name_scan continuation token format.  */
+constexpr uint8_t NAME_SCAN_CONTINUATION_VERSION = 1;
+
+/**
+ * Encodes the opaque continuation token returned by name_scan and
+ * name_pending for a page whose last name is the given one.
+ */
+std::string
+EncodeNameScanContinuation (const valtype& lastName)
+{
+  CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+  ss << NAME_SCAN_CONTINUATION_VERSION << lastName;
+  return HexStr (ss);
+}
+
+/**
+ * Decodes a name_scan continuation token and returns the last name of the
+ * previous page.  Throws an RPC error if the token is invalid.
+ */
+valtype
+DecodeNameScanContinuation (const std::string& token)
+{
+  const auto invalid
+      = JSONRPCError (RPC_INVALID_PARAMETER, "invalid continuation token");
+  if (!IsHex (token))
+    throw invalid;
+
+  CDataStream ss(ParseHex (token), SER_NETWORK, PROTOCOL_VERSION);
+  uint8_t version;
+  valtype lastName;
+  try
+    {
+      ss >> version >> lastName;
+    }
+  catch (const std::ios_base::failure& exc)
+    {
+      throw invalid;
+    }
+
+  if (version != NAME_SCAN_CONTINUATION_VERSION || !ss.empty ())
+    throw invalid;
+
+  return lastName;
+}
+
+/** Version of the name_history continuation token format.  */
+constexpr uint8_t NAME_HISTORY_CONTINUATION_VERSION = 1;
+
+/**
+ * Encodes the opaque continuation token returned by name_history for a
+ * page that is followed by the entry with the given history key.
+ */
+std::string
+EncodeNameHistoryContinuation (const CNameHistory::Key& next)
+{
+  CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+  ss << NAME_HISTORY_CONTINUATION_VERSION << next.first << next.second;
+  return HexStr (ss);
+}
+
+/**
+ * Decodes a name_history continuation token and returns the history key
+ * of the first entry of the next page.  Throws an RPC error if the token
+ * is invalid.
+ */
+CNameHistory::Key
+DecodeNameHistoryContinuation (const std::string& token)
+{
+  const auto invalid
+      = JSONRPCError (RPC_INVALID_PARAMETER, "invalid continuation token");
+  if (!IsHex (token))
+    throw invalid;
+
+  CDataStream ss(ParseHex (token), SER_NETWORK, PROTOCOL_VERSION);
+  uint8_t version;
+  CNameHistory::Key next;
+  try
+    {
+      ss >> version >> next.first >> next.second;
+    }
+  catch (const std::ios_base::failure& exc)
+    {
+      throw invalid;
+    }
+
+  if (version != NAME_HISTORY_CONTINUATION_VERSION || !ss.empty ())
+    throw invalid;
+
+  return next;
+}
+
 NameEncoding
 EncodingFromOptionsJson (const UniValue& options, const std::string& field,
                          const NameEncoding defaultValue)
@@ -517,18 +614,22 @@ name_show ()
 /* ************************************************************************** */
 
 RPCHelpMan
-name_history ()
+name_showbyhashes ()
 {
   NameOptionsHelp optHelp;
   optHelp
       .withNameEncoding ()
-      .withValueEncoding ()
-      .withByHash ();
+      .withValueEncoding ();
 
-  return RPCHelpMan ("name_history",
-      "\nLooks up the current and all past data for the given name.  -namehistory must be enabled.\n",
+  return RPCHelpMan ("name_showbyhashes",
+      "\nLooks up the current data for many names given by their SHA-256d hashes.  -namehashindex must be enabled.\n"
+      "\nThe result contains one entry per hash, which is null if the hash is not known or the name does not exist.\n",
       {
-          {"name", RPCArg::Type::STR, RPCArg::Optional::NO, "The name to query for"},
+          {"hashes", RPCArg::Type::ARR, RPCArg::Optional::NO, "The name hashes to query for",
+              {
+                  {"hash", RPCArg::Type::STR_HEX, RPCArg::Optional::OMITTED, "SHA-256d hash of a name"},
+              },
+          },
           optHelp.buildRpcArg (),
       },
       RPCResult {RPCResult::Type::ARR, "", "",
@@ -538,8 +639,119 @@ name_history ()
                 .finish ()
           }
       },
+      RPCExamples {
+          HelpExampleCli ("name_showbyhashes", "'[\"hash1\", \"hash2\"]'")
+        + HelpExampleRpc ("name_showbyhashes", "[\"hash1\", \"hash2\"]")
+      },
+      [&] (const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+  RPCTypeCheck (request.params, {UniValue::VARR, UniValue::VOBJ});
+  auto& chainman = EnsureAnyChainman (request.context);
+
+  if (g_name_hash_index == nullptr)
+    throw std::runtime_error ("-namehashindex is not enabled");
+  if (!g_name_hash_index->BlockUntilSyncedToCurrentChain ())
+    throw std::runtime_error ("The name-hash index is not caught up yet");
+
+  if (chainman.ActiveChainstate ().IsInitialBlockDownload ())
+    throw JSONRPCError(RPC_CLIENT_IN_INITIAL_DOWNLOAD,
+                       "SpaceXpanse is downloading blocks...");
+
+  UniValue options(UniValue::VOBJ);
+  if (request.params.size () >= 2)
+    options = request.params[1].get_obj ();
+
+  const UniValue& hashesArr = request.params[0].get_array ();
+  std::vector<uint256> hashes;
+  hashes.reserve (hashesArr.size ());
+  for (size_t i = 0; i < hashesArr.size (); ++i)
+    {
+      const valtype bytes = ParseHexV (hashesArr[i], "hash");
+      if (bytes.size () != 32)
+        throw JSONRPCError (RPC_INVALID_PARAMETER,
+                            "SHA-256d hash must be 32 bytes long");
+      hashes.emplace_back (bytes);
+    }
+
+  std::map<uint256, valtype> names;
+  g_name_hash_index->FindNamePreimages (hashes, names);
+
+  MaybeWalletForRequest wallet(request);
+  LOCK2 (wallet.getLock (), cs_main);
+  const auto& coinsTip = chainman.ActiveChainstate ().CoinsTip ();
+
+  UniValue res(UniValue::VARR);
+  for (const auto& hash : hashes)
+    {
+      const auto mit = names.find (hash);
+      CNameData data;
+      if (mit == names.end () || !coinsTip.GetName (mit->second, data))
+        {
+          res.push_back (NullUniValue);
+          continue;
+        }
+
+      res.push_back (getNameInfo (chainman, options, mit->second, data,
+                                  wallet));
+    }
+
+  return res;
+}
+  );
+}
+
+/* ************************************************************************** */
+
+RPCHelpMan
+name_history ()
+{
+  NameOptionsHelp optHelp;
+  optHelp
+      .withNameEncoding ()
+      .withValueEncoding ()
+      .withByHash ()
+      .withArg ("minHeight", RPCArg::Type::NUM, "0",
+                "Only return entries with at least this height")
+      .withArg ("count", RPCArg::Type::NUM,
+                "Return at most this many entries")
+      .withArg ("paged", RPCArg::Type::BOOL, "false",
+                "Return an object with a continuation token")
+      .withArg ("continuation", RPCArg::Type::STR,
+                "Continue after the page that returned this token");
+
+  return RPCHelpMan ("name_history",
+      "\nLooks up the current and all past data for the given name.  -namehistory must be enabled.\n"
+      "\nThe entries are sorted chronologically, also for multiple updates of the name in the same block.\n"
+      "\nWith \"paged\", the result is an object that contains a \"continuation\" token if more entries follow the \"count\" returned ones.  Passing it back as the \"continuation\" option returns the next page.\n",
+      {
+          {"name", RPCArg::Type::STR, RPCArg::Optional::NO, "The name to query for"},
+          optHelp.buildRpcArg (),
+      },
+      {
+          RPCResult {"if paged is false", RPCResult::Type::ARR, "", "",
+              {
+                  NameInfoHelp ()
+                    .withHeight ()
+                    .finish ()
+              }
+          },
+          RPCResult {"if paged is true", RPCResult::Type::OBJ, "", "",
+              {
+                  {RPCResult::Type::ARR, "history", "The history entries",
+                      {
+                          NameInfoHelp ()
+                            .withHeight ()
+                            .finish ()
+                      }
+                  },
+                  {RPCResult::Type::STR, "continuation", /* optional */ true,
+                   "Token to get the next page, if there are more entries"},
+              }
+          },
+      },
       RPCExamples {
           HelpExampleCli ("name_history", "\"myname\"")
+        + HelpExampleCli ("name_history", "\"myname\" '{\"count\": 10, \"paged\": true}'")
         + HelpExampleRpc ("name_history", "\"myname\"")
       },
       [&] (const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
@@ -560,13 +772,51 @@ name_history ()
 
   const valtype name = GetNameForLookup (request.params[0], options);
 
-  CNameData data;
+  /* Parse and interpret the name_history-specific options.  */
+  RPCTypeCheckObj (options,
+    {
+      {"minHeight", UniValueType (UniValue::VNUM)},
+      {"count", UniValueType (UniValue::VNUM)},
+      {"paged", UniValueType (UniValue::VBOOL)},
+      {"continuation", UniValueType (UniValue::VSTR)},
+    },
+    true, false);
+
+  CNameHistory::Key start(0, 0);
+  if (options.exists ("minHeight"))
+    {
+      const int minHeight = options["minHeight"].get_int ();
+      if (minHeight < 0)
+        throw JSONRPCError (RPC_INVALID_PARAMETER,
+                            "minHeight must not be negative");
+      start.first = minHeight;
+    }
+
+  size_t count = std::numeric_limits<size_t>::max ();
+  if (options.exists ("count"))
+    {
+      const int64_t countArg = options["count"].get_int64 ();
+      if (countArg < 0)
+        throw JSONRPCError (RPC_INVALID_PARAMETER,
+                            "count must not be negative");
+      count = countArg;
+    }
+
+  bool paged = false;
+  if (options.exists ("paged"))
+    paged = options["paged"].get_bool ();
+
+  if (options.exists ("continuation"))
+    start = std::max (start, DecodeNameHistoryContinuation (
+                                 options["continuation"].get_str ()));
+
   CNameHistory history;
 
   {
     LOCK (cs_main);
 
     const auto& coinsTip = chainman.ActiveChainstate ().CoinsTip ();
+    CNameData data;
     if (!coinsTip.GetName (name, data))
       {
         std::ostringstream msg;
@@ -574,17 +824,42 @@ name_history ()
         throw JSONRPCError (RPC_WALLET_ERROR, msg.str ());
       }
 
-    if (!coinsTip.GetNameHistory (name, history))
+    /* Read one more entry than requested, so that we know whether there
+       are more for another page.  */
+    const size_t readCount
+        = count < std::numeric_limits<size_t>::max () ? count + 1 : count;
+    if (!coinsTip.GetNameHistoryRange (name, start, readCount, history))
       assert (history.empty ());
+
+    /* The current data follows all history entries, with the key that it
+       will get once it is added to the history as well.  */
+    CNameHistory atHeight;
+    coinsTip.GetNameHistoryRange (name,
+                                  CNameHistory::Key (data.getHeight (), 0),
+                                  std::numeric_limits<size_t>::max (),
+                                  atHeight);
+    const CNameHistory::Key currentKey(data.getHeight (),
+                                       atHeight.getData ().size ());
+    if (history.getData ().size () < readCount && currentKey >= start)
+      history.push (currentKey, data);
   }
 
   MaybeWalletForRequest wallet(request);
   LOCK2 (wallet.getLock (), cs_main);
 
-  UniValue res(UniValue::VARR);
-  for (const auto& entry : history.getData ())
-    res.push_back (getNameInfo (chainman, options, name, entry, wallet));
-  res.push_back (getNameInfo (chainman, options, name, data, wallet));
+  UniValue entries(UniValue::VARR);
+  const auto& data = history.getData ();
+  for (size_t i = 0; i < data.size () && i < count; ++i)
+    entries.push_back (getNameInfo (chainman, options, name, data[i], wallet));
+
+  if (!paged)
+    return entries;
+
+  UniValue res(UniValue::VOBJ);
+  res.pushKV ("history", entries);
+  if (data.size () > count)
+    res.pushKV ("continuation",
+                EncodeNameHistoryContinuation (history.getKeys ()[count]));
 
   return res;
 }
@@ -607,26 +882,48 @@ name_scan ()
       .withArg ("prefix", RPCArg::Type::STR,
                 "Filter for names with the given prefix")
       .withArg ("regexp", RPCArg::Type::STR,
-                "Filter for names matching the regexp");
+                "Filter for names matching the regexp")
+      .withArg ("paged", RPCArg::Type::BOOL, "false",
+                "Return an object with a continuation token")
+      .withArg ("continuation", RPCArg::Type::STR,
+                "Continue after the page that returned this token");
 
   return RPCHelpMan ("name_scan",
-      "\nLists names in the database.\n",
+      "\nLists names in the database.\n"
+      "\nWith \"paged\", the result is an object that contains a \"continuation\" token if more names follow the \"count\" returned ones.  Passing it back as the \"continuation\" option returns the names following the previous page.\n"
+      "\nWith -nameheightindex, filtering by \"maxConf\" only reads the names updated in that range of blocks.\n",
       {
           {"start", RPCArg::Type::STR, RPCArg::Default{""}, "Skip initially to this name"},
           {"count", RPCArg::Type::NUM, RPCArg::Default{500}, "Stop after this many names"},
           optHelp.buildRpcArg (),
       },
-      RPCResult {RPCResult::Type::ARR, "", "",
-          {
-              NameInfoHelp ()
-                .withHeight ()
-                .finish ()
-          }
+      {
+          RPCResult {"if paged is false", RPCResult::Type::ARR, "", "",
+              {
+                  NameInfoHelp ()
+                    .withHeight ()
+                    .finish ()
+              }
+          },
+          RPCResult {"if paged is true", RPCResult::Type::OBJ, "", "",
+              {
+                  {RPCResult::Type::ARR, "names", "The names found",
+                      {
+                          NameInfoHelp ()
+                            .withHeight ()
+                            .finish ()
+                      }
+                  },
+                  {RPCResult::Type::STR, "continuation", /* optional */ true,
+                   "Token to get the next page, if more names follow"},
+              }
+          },
       },
       RPCExamples {
           HelpExampleCli ("name_scan", "")
         + HelpExampleCli ("name_scan", "\"d/abc\"")
         + HelpExampleCli ("name_scan", "\"d/abc\" 10")
+        + HelpExampleCli ("name_scan", "\"\" 10 '{\"prefix\": \"p/\", \"paged\": true}'")
         + HelpExampleRpc ("name_scan", "\"d/abc\"")
       },
       [&] (const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
@@ -658,6 +955,8 @@ name_scan ()
       {"maxConf", UniValueType (UniValue::VNUM)},
       {"prefix", UniValueType (UniValue::VSTR)},
       {"regexp", UniValueType (UniValue::VSTR)},
+      {"paged", UniValueType (UniValue::VBOOL)},
+      {"continuation", UniValueType (UniValue::VSTR)},
     },
     true, false);
 
@@ -688,10 +987,41 @@ name_scan ()
       regexp = boost::xpressive::sregex::compile (options["regexp"].get_str ());
     }
 
+  bool paged = false;
+  if (options.exists ("paged"))
+    paged = options["paged"].get_bool ();
+
+  /* With a continuation token, we start at the last name of the previous
+     page and skip it.  */
+  bool skipStart = false;
+  if (options.exists ("continuation"))
+    {
+      if (!start.empty ())
+        throw JSONRPCError (RPC_INVALID_PARAMETER,
+                            "start and continuation must not both be given");
+      start = DecodeNameScanContinuation (options["continuation"].get_str ());
+      skipStart = true;
+    }
+
   /* Iterate over names and produce the result.  */
-  UniValue res(UniValue::VARR);
+  UniValue names(UniValue::VARR);
+  bool more = false;
+  valtype lastName;
+
+  const auto finish = [&] ()
+    {
+      if (!paged)
+        return names;
+
+      UniValue res(UniValue::VOBJ);
+      res.pushKV ("names", names);
+      if (more)
+        res.pushKV ("continuation", EncodeNameScanContinuation (lastName));
+      return res;
+    };
+
   if (count <= 0)
-    return res;
+    return finish ();
 
   MaybeWalletForRequest wallet(request);
   LOCK2 (wallet.getLock (), cs_main);
@@ -701,22 +1031,25 @@ name_scan ()
   if (maxConf >= 0)
     minHeight = chainman.ActiveHeight () - maxConf + 1;
 
-  valtype name;
-  CNameData data;
+  /* Checks the filters on a name and adds it to the result if they match.
+     Returns false once a matching name is found after the result is full,
+     which means that there is another page.  */
   const auto& coinsTip = chainman.ActiveChainstate ().CoinsTip ();
-  std::unique_ptr<CNameIterator> iter(coinsTip.IterateNames ());
-  for (iter->seek (start); count > 0 && iter->next (name, data); )
+  const auto processName = [&] (const valtype& name, const CNameData& data)
     {
+      if (skipStart && name == start)
+        return true;
+
       const int height = data.getHeight ();
       if (height > maxHeight)
-        continue;
+        return true;
       if (minHeight >= 0 && height < minHeight)
-        continue;
+        return true;
 
       if (name.size () < prefix.size ())
-        continue;
+        return true;
       if (!std::equal (prefix.begin (), prefix.end (), name.begin ()))
-        continue;
+        return true;
 
       if (haveRegexp)
         {
@@ -725,19 +1058,61 @@ name_scan ()
               const std::string nameStr = EncodeName (name, NameEncoding::UTF8);
               boost::xpressive::smatch matches;
               if (!boost::xpressive::regex_search (nameStr, matches, regexp))
-                continue;
+                return true;
             }
           catch (const InvalidNameString& exc)
             {
-              continue;
+              return true;
             }
         }
 
-      res.push_back (getNameInfo (chainman, options, name, data, wallet));
+      if (count == 0)
+        {
+          more = true;
+          return false;
+        }
+
+      names.push_back (getNameInfo (chainman, options, name, data, wallet));
+      lastName = name;
       --count;
+
+      return true;
+    };
+
+  if (fNameHeightIndex && maxConf >= 0)
+    {
+      /* Only look at the names updated in the requested range of blocks,
+         rather than iterating the full name database.  */
+      if (maxHeight < std::max (minHeight, 0))
+        return finish ();
+
+      CNameCache::NameSet candidates;
+      coinsTip.GetNamesInHeightRange (std::max (minHeight, 0), maxHeight,
+                                      candidates);
+
+      for (auto it = candidates.lower_bound (start);
+           it != candidates.end (); ++it)
+        {
+          CNameData data;
+          CHECK_NONFATAL (coinsTip.GetName (*it, data));
+          if (!processName (*it, data))
+            break;
+        }
+
+      return finish ();
     }
 
-  return res;
+  std::unique_ptr<CNameIterator> iter(coinsTip.IterateNames ());
+  if (!prefix.empty ())
+    iter.reset (new CPrefixNameIterator (iter.release (), prefix));
+
+  valtype name;
+  CNameData data;
+  for (iter->seek (start); iter->next (name, data); )
+    if (!processName (name, data))
+      break;
+
+  return finish ();
 }
   );
 }
@@ -750,26 +1125,51 @@ name_pending ()
   NameOptionsHelp optHelp;
   optHelp
       .withNameEncoding ()
-      .withValueEncoding ();
+      .withValueEncoding ()
+      .withArg ("count", RPCArg::Type::NUM,
+                "Return operations for at most this many names")
+      .withArg ("paged", RPCArg::Type::BOOL, "false",
+                "Return an object with a continuation token")
+      .withArg ("continuation", RPCArg::Type::STR,
+                "Continue after the page that returned this token");
 
   return RPCHelpMan ("name_pending",
       "\nLists unconfirmed name operations in the mempool.\n"
-      "\nIf a name is given, only check for operations on this name.\n",
+      "\nIf a name is given, only check for operations on this name.\n"
+      "\nThe operations are ordered by name, and for each name in the order in which they build on each other.\n"
+      "\nWith \"paged\", the result is an object that contains a \"continuation\" token if operations for more names follow the \"count\" returned ones.  Passing it back as the \"continuation\" option returns the operations of the names following the previous page.\n",
       {
           {"name", RPCArg::Type::STR, RPCArg::Optional::OMITTED_NAMED_ARG, "Only look for this name"},
           optHelp.buildRpcArg (),
       },
-      RPCResult {RPCResult::Type::ARR, "", "",
-          {
-              NameInfoHelp ()
-                .withField ({RPCResult::Type::STR, "op", "the operation being performed"})
-                .withHeight ()
-                .finish ()
-          }
+      {
+          RPCResult {"if paged is false", RPCResult::Type::ARR, "", "",
+              {
+                  NameInfoHelp ()
+                    .withField ({RPCResult::Type::STR, "op", "the operation being performed"})
+                    .withHeight ()
+                    .finish ()
+              }
+          },
+          RPCResult {"if paged is true", RPCResult::Type::OBJ, "", "",
+              {
+                  {RPCResult::Type::ARR, "ops", "The pending operations",
+                      {
+                          NameInfoHelp ()
+                            .withField ({RPCResult::Type::STR, "op", "the operation being performed"})
+                            .withHeight ()
+                            .finish ()
+                      }
+                  },
+                  {RPCResult::Type::STR, "continuation", /* optional */ true,
+                   "Token to get the next page, if more names follow"},
+              }
+          },
       },
       RPCExamples {
           HelpExampleCli ("name_pending", "")
         + HelpExampleCli ("name_pending", "\"d/domob\"")
+        + HelpExampleCli ("name_pending", "null '{\"count\": 100, \"paged\": true}'")
         + HelpExampleRpc ("name_pending", "")
       },
       [&] (const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
@@ -778,40 +1178,56 @@ name_pending ()
 
   MaybeWalletForRequest wallet(request);
   auto& mempool = EnsureAnyMemPool (request.context);
-  LOCK2 (wallet.getLock (), mempool.cs);
 
   UniValue options(UniValue::VOBJ);
   if (request.params.size () >= 2)
     options = request.params[1].get_obj ();
 
-  std::vector<uint256> txHashes;
-  mempool.queryHashes (txHashes);
+  RPCTypeCheckObj (options,
+    {
+      {"count", UniValueType (UniValue::VNUM)},
+      {"paged", UniValueType (UniValue::VBOOL)},
+      {"continuation", UniValueType (UniValue::VSTR)},
+    },
+    true, false);
 
   const bool hasNameFilter = !request.params[0].isNull ();
   valtype nameFilter;
   if (hasNameFilter)
     nameFilter = DecodeNameFromRPCOrThrow (request.params[0], options);
 
-  UniValue arr(UniValue::VARR);
-  for (const auto& txHash : txHashes)
+  int64_t count = -1;
+  if (options.exists ("count"))
+    {
+      count = options["count"].get_int64 ();
+      if (count < 0)
+        throw JSONRPCError (RPC_INVALID_PARAMETER,
+                            "count must not be negative");
+    }
+
+  bool paged = false;
+  if (options.exists ("paged"))
+    paged = options["paged"].get_bool ();
+
+  bool haveStart = false;
+  valtype start;
+  if (options.exists ("continuation"))
     {
-      std::shared_ptr<const CTransaction> tx = mempool.get (txHash);
-      if (!tx)
-        continue;
+      start = DecodeNameScanContinuation (options["continuation"].get_str ());
+      haveStart = true;
+    }
 
-      for (size_t n = 0; n < tx->vout.size (); ++n)
-        {
-          const auto& txOut = tx->vout[n];
-          const CNameScript op(txOut.scriptPubKey);
-          if (!op.isNameOp () || !op.isAnyUpdate ())
-            continue;
-          if (hasNameFilter && op.getOpName () != nameFilter)
-            continue;
+  LOCK2 (wallet.getLock (), mempool.cs);
 
+  UniValue arr(UniValue::VARR);
+  const auto addChain = [&] (const CNameMemPool::PendingChain& chain)
+    {
+      for (const auto& pending : chain)
+        {
+          const auto& op = pending.op;
           UniValue obj = getNameInfo (options,
                                       op.getOpName (), op.getOpValue (),
-                                      COutPoint (tx->GetHash (), n),
-                                      op.getAddress ());
+                                      pending.output, op.getAddress ());
           addOwnershipInfo (op.getAddress (), wallet, obj);
           switch (op.getNameOp ())
             {
@@ -827,9 +1243,46 @@ name_pending ()
 
           arr.push_back (obj);
         }
+    };
+
+  /* With a name filter, there is at most one name and thus never another
+     page.  Otherwise there is one if names are left after the count.  */
+  bool more = false;
+  valtype lastName = start;
+  if (hasNameFilter)
+    {
+      const auto* chain = mempool.getPendingNameChain (nameFilter);
+      const bool skipped = haveStart && nameFilter <= start;
+      if (chain != nullptr && count != 0 && !skipped)
+        addChain (*chain);
     }
+  else
+    {
+      const auto& pending = mempool.getPendingNames ();
+      auto it = haveStart ? pending.upper_bound (start) : pending.begin ();
+      int64_t numNames = 0;
+      for (; it != pending.end (); ++it)
+        {
+          if (count >= 0 && numNames >= count)
+            {
+              more = true;
+              break;
+            }
 
-  return arr;
+          addChain (it->second);
+          lastName = it->first;
+          ++numNames;
+        }
+    }
+
+  if (!paged)
+    return arr;
+
+  UniValue res(UniValue::VOBJ);
+  res.pushKV ("ops", arr);
+  if (more)
+    res.pushKV ("continuation", EncodeNameScanContinuation (lastName));
+  return res;
 }
   );
 }
@@ -989,10 +1442,14 @@ name_checkdb ()
   return RPCHelpMan ("name_checkdb",
       "\nValidates the name DB's consistency.\n"
       "\nRoughly between blocks 139,000 and 180,000, this call is expected to fail due to the historic 'name stealing' bug.\n",
-      {},
+      {
+          {"incremental", RPCArg::Type::BOOL, RPCArg::Default{false},
+           "Only check the names changed since the last successful check.  The first check after startup is always a full one, and so are all checks if -checknamedb is disabled."},
+      },
       RPCResult {RPCResult::Type::BOOL, "", "whether the state is valid"},
       RPCExamples {
           HelpExampleCli ("name_checkdb", "")
+        + HelpExampleCli ("name_checkdb", "true")
         + HelpExampleRpc ("name_checkdb", "")
       },
       [&] (const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
@@ -1003,7 +1460,9 @@ name_checkdb ()
   LOCK (cs_main);
   auto& coinsTip = chainman.ActiveChainstate ().CoinsTip ();
   coinsTip.Flush ();
-  return coinsTip.ValidateNameDB (chainman.ActiveChainstate (),
+  const bool incremental
+      = !request.params[0].isNull () && request.params[0].get_bool ();
+  return coinsTip.ValidateNameDB (chainman.ActiveChainstate (), incremental,
                                   node.rpc_interruption_point);
 }
   );
@@ -1018,6 +1477,7 @@ static const CRPCCommand commands[] =
 { //  category               actor (function)
   //  ---------------------  -----------------------
     { "names",               &name_show,               },
+    { "names",               &name_showbyhashes,       },
     { "names",               &name_history,            },
     { "names",               &name_scan,               },
     { "names",               &name_pending,            },
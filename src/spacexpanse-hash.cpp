@@ -2,8 +2,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
-/* Command-line utility to compute the PoW hash of a block header given in hex.
-   This is used for the regtests to access Neoscrypt from Python.  */
+/* Command-line utility to compute the PoW hashes of block headers given in hex.
+   This is used for the regtests to access Neoscrypt from Python.  If several
+   headers are given, they are hashed as one batch and their hashes printed
+   one per line in the same order.  */
 
 #include <core_io.h>
 #include <powdata.h>
@@ -12,28 +14,36 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <vector>
 
 int main (int argc, char** argv)
 {
-  if (argc != 3)
+  if (argc < 3)
     {
-      std::cerr << "USAGE: spacexpanse-hash ALGO BLOCK-HEADER-HEX" << std::endl;
+      std::cerr << "USAGE: spacexpanse-hash ALGO BLOCK-HEADER-HEX..."
+                << std::endl;
       return EXIT_FAILURE;
     }
   const std::string algoStr(argv[1]);
-  const std::string hex(argv[2]);
 
-  CPureBlockHeader header;
-  if (!DecodeHexPureHeader (header, hex))
-    {
-      std::cerr << "Failed to decode block header." << std::endl;
-      return EXIT_FAILURE;
-    }
+  std::vector<CPureBlockHeader> headers(argc - 2);
+  for (int i = 2; i < argc; ++i)
+    if (!DecodeHexPureHeader (headers[i - 2], argv[i]))
+      {
+        std::cerr << "Failed to decode block header." << std::endl;
+        return EXIT_FAILURE;
+      }
 
   try
     {
-      const uint256 hash = header.GetPowHash (PowAlgoFromString (algoStr));
-      std::cout << hash.GetHex () << std::endl;
+      const PowAlgo algo = PowAlgoFromString (algoStr);
+
+      std::vector<const CPureBlockHeader*> ptrs;
+      for (const auto& hdr : headers)
+        ptrs.push_back (&hdr);
+
+      for (const auto& hash : GetPowHashes (ptrs, algo))
+        std::cout << hash.GetHex () << std::endl;
     }
   catch (const std::exception& exc)
     {
@@ -6,22 +6,29 @@
 #include <auxpow.h>
 #include <chainparams.h>
 #include <coins.h>
+#include <consensus/consensus.h>
 #include <consensus/merkle.h>
 #include <validation.h>
 #include <pow.h>
 #include <primitives/block.h>
 #include <rpc/auxpow_miner.h>
+#include <rpc/server.h>
 #include <script/script.h>
+#include <sync.h>
 #include <util/strencodings.h>
 #include <util/time.h>
 #include <uint256.h>
 #include <univalue.h>
+#include <validationinterface.h>
 
+#include <test/util/mining.h>
 #include <test/util/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
 
 #include <algorithm>
+#include <chrono>
+#include <thread>
 #include <vector>
 
 /* No space between BOOST_AUTO_TEST_SUITE and '(', so that extraction of
@@ -384,24 +391,56 @@ private:
 
 public:
 
-  explicit AuxpowMinerForTest (const NodeContext& n)
-    : node(n)
+  explicit AuxpowMinerForTest (const NodeContext& n,
+                               const size_t maxBlocks
+                                  = DEFAULT_MAX_SAVED_BLOCKS)
+    : AuxpowMiner(maxBlocks), node(n)
   {}
 
   using AuxpowMiner::cs;
   using AuxpowMiner::lookupSavedBlock;
 
+  /**
+   * Returns the current block.  Unless notifications are started, there is
+   * no worker thread, so that template rebuilds happen synchronously.
+   */
   const CBlock*
   getCurrentBlock (const PowAlgo algo, const CScript& scriptPubKey,
                    uint256& target)
   {
-    return AuxpowMiner::getCurrentBlock (*node.chainman, *node.mempool, algo,
-                                         scriptPubKey, target);
+    return AuxpowMiner::getCurrentBlock (*node.chainman, *node.mempool,
+                                         algo, scriptPubKey, target);
+  }
+
+  std::string
+  getLongPollId (const PowAlgo algo)
+  {
+    LOCK (cs);
+    return AuxpowMiner::getLongPollId (*node.chainman, algo);
+  }
+
+  void
+  waitForNewWork (const PowAlgo algo, const std::string& longpollid)
+  {
+    AuxpowMiner::waitForNewWork (*node.chainman, algo, longpollid);
+  }
+
+  /**
+   * Returns true if there is a base template for the algo on the current
+   * chain tip.
+   */
+  bool
+  hasBaseTemplate (const PowAlgo algo)
+  {
+    LOCK (cs);
+    return baseTemplates.count (algo) > 0
+            && pindexPrev == WITH_LOCK (cs_main,
+                                        return node.chainman->ActiveTip ());
   }
 
 };
 
-BOOST_FIXTURE_TEST_CASE (auxpow_miner_blockRegeneration, TestChain100Setup)
+BOOST_FIXTURE_TEST_CASE (auxpow_miner_blockRegeneration, RegTestingSetup)
 {
   AuxpowMinerForTest miner(m_node);
   LOCK (miner.cs);
@@ -444,7 +483,7 @@ BOOST_FIXTURE_TEST_CASE (auxpow_miner_blockRegeneration, TestChain100Setup)
   /* Mine a block, then we should get a new auxpow block constructed.  Note that
      it can be the same *pointer* if the memory was reused after clearing it,
      so we can only verify that the hash is different.  */
-  CreateAndProcessBlock ({}, scriptPubKey);
+  MineBlock (m_node, scriptPubKey);
   const CBlock* pblock3 = miner.getCurrentBlock (PowAlgo::SHA256D,
                                                  scriptPubKey, target);
   BOOST_CHECK (pblock3 != nullptr);
@@ -475,7 +514,7 @@ BOOST_FIXTURE_TEST_CASE (auxpow_miner_blockRegeneration, TestChain100Setup)
   BOOST_CHECK (pblock4 != pblock3 && pblock4->GetHash () != hash3);
 }
 
-BOOST_FIXTURE_TEST_CASE (auxpow_miner_createAndLookupBlock, TestChain100Setup)
+BOOST_FIXTURE_TEST_CASE (auxpow_miner_createAndLookupBlock, RegTestingSetup)
 {
   AuxpowMinerForTest miner(m_node);
   LOCK (miner.cs);
@@ -490,6 +529,166 @@ BOOST_FIXTURE_TEST_CASE (auxpow_miner_createAndLookupBlock, TestChain100Setup)
   BOOST_CHECK_THROW (miner.lookupSavedBlock ("foobar"), UniValue);
 }
 
+BOOST_FIXTURE_TEST_CASE (auxpow_miner_payoutScripts, RegTestingSetup)
+{
+  AuxpowMinerForTest miner(m_node, 2);
+  LOCK (miner.cs);
+
+  const CScript scriptA = CScript () << OP_TRUE;
+  const CScript scriptB = CScript () << OP_2;
+  const CScript scriptC = CScript () << OP_3;
+
+  /* Blocks for different payout scripts are derived from the same template
+     and only differ in the coinbase.  */
+  uint256 target;
+  const CBlock* pblockA = miner.getCurrentBlock (PowAlgo::NEOSCRYPT,
+                                                 scriptA, target);
+  const CBlock* pblockB = miner.getCurrentBlock (PowAlgo::NEOSCRYPT,
+                                                 scriptB, target);
+  BOOST_CHECK (pblockA != pblockB);
+  BOOST_CHECK (pblockA->GetHash () != pblockB->GetHash ());
+  BOOST_CHECK (pblockA->vtx[0]->vout[0].scriptPubKey == scriptA);
+  BOOST_CHECK (pblockB->vtx[0]->vout[0].scriptPubKey == scriptB);
+  BOOST_CHECK_EQUAL (pblockA->vtx[0]->vout[0].nValue,
+                     pblockB->vtx[0]->vout[0].nValue);
+  BOOST_CHECK (pblockA->hashMerkleRoot == BlockMerkleRoot (*pblockA));
+  BOOST_CHECK (pblockB->hashMerkleRoot == BlockMerkleRoot (*pblockB));
+  BOOST_CHECK (pblockA->hashPrevBlock == pblockB->hashPrevBlock);
+
+  /* Asking again for A returns the cached block and marks it as recently
+     used, so that B is evicted when C is added.  */
+  BOOST_CHECK (miner.getCurrentBlock (PowAlgo::NEOSCRYPT, scriptA, target)
+                == pblockA);
+  const uint256 hashB = pblockB->GetHash ();
+  const CBlock* pblockC = miner.getCurrentBlock (PowAlgo::NEOSCRYPT,
+                                                 scriptC, target);
+  BOOST_CHECK (miner.lookupSavedBlock (pblockA->GetHash ().GetHex ())
+                == pblockA);
+  BOOST_CHECK (miner.lookupSavedBlock (pblockC->GetHash ().GetHex ())
+                == pblockC);
+  BOOST_CHECK_THROW (miner.lookupSavedBlock (hashB.GetHex ()), UniValue);
+
+  /* B gets a fresh block again.  */
+  pblockB = miner.getCurrentBlock (PowAlgo::NEOSCRYPT, scriptB, target);
+  BOOST_CHECK (pblockB->GetHash () != hashB);
+  BOOST_CHECK (pblockB->vtx[0]->vout[0].scriptPubKey == scriptB);
+  BOOST_CHECK (miner.lookupSavedBlock (pblockB->GetHash ().GetHex ())
+                == pblockB);
+}
+
+BOOST_FIXTURE_TEST_CASE (auxpow_miner_worker, RegTestingSetup)
+{
+  /* Mine enough blocks so that we have a mature coin to pay fees with.  */
+  const CScript script = CScript () << OP_TRUE;
+  std::vector<CTxIn> coins;
+  for (int i = 0; i <= COINBASE_MATURITY; ++i)
+    coins.push_back (MineBlock (m_node, script));
+
+  /* Long-polling requests fail if the RPC server is not running.  */
+  StartRPC ();
+
+  AuxpowMinerForTest miner(m_node);
+  miner.startNotifications (*m_node.chainman, *m_node.mempool);
+
+  Mutex csWork;
+  std::vector<UniValue> pushedWork;
+  miner.addWorkListener ([&] (const UniValue& work)
+    {
+      LOCK (csWork);
+      pushedWork.push_back (work);
+    });
+  /* Listeners are notified after long-polling clients are woken up, so
+     give the worker thread some time to push the work.  */
+  const auto waitForPushedWork = [&] (const size_t num)
+    {
+      for (unsigned i = 0; i < 1000; ++i)
+        {
+          if (WITH_LOCK (csWork, return pushedWork.size ()) >= num)
+            break;
+          std::this_thread::sleep_for (std::chrono::milliseconds {10});
+        }
+    };
+
+  const int64_t baseTime
+      = m_node.chainman->ActiveChain ().Tip ()->GetMedianTimePast () + 1;
+  SetMockTime (baseTime);
+
+  uint256 target;
+  const CBlock* pblock;
+  pblock = WITH_LOCK (miner.cs, return miner.getCurrentBlock (
+                                  PowAlgo::SHA256D, script, target));
+  const uint256 hash1 = pblock->GetHash ();
+  const CAmount value1 = pblock->vtx[0]->vout[0].nValue;
+  const std::string longpollid = miner.getLongPollId (PowAlgo::SHA256D);
+
+  /* Add a transaction paying a fee, so that a rebuilt template is better.  */
+  CMutableTransaction mtx;
+  mtx.vin.push_back (coins[0]);
+  CAmount fee;
+  {
+    LOCK (cs_main);
+    const Coin& coin
+        = m_node.chainman->ActiveChainstate ().CoinsTip ().AccessCoin (
+            coins[0].prevout);
+    fee = coin.out.nValue / 2;
+    mtx.vout.emplace_back (coin.out.nValue - fee, script);
+  }
+  {
+    TestMemPoolEntryHelper entry;
+    LOCK2 (cs_main, m_node.mempool->cs);
+    m_node.mempool->addUnchecked (entry.Fee (fee).SpendsCoinbase (true)
+                                    .FromTx (mtx));
+  }
+
+  /* With the worker thread, the old block keeps being served while the
+     template is rebuilt in the background.  */
+  SetMockTime (baseTime + 61);
+  pblock = WITH_LOCK (miner.cs, return miner.getCurrentBlock (
+                                  PowAlgo::SHA256D, script, target));
+  BOOST_CHECK (pblock->GetHash () == hash1);
+
+  /* Long-polling returns once the new template is installed, and then the
+     block handed out includes the transaction.  */
+  miner.waitForNewWork (PowAlgo::SHA256D, longpollid);
+  BOOST_CHECK (miner.getLongPollId (PowAlgo::SHA256D) != longpollid);
+  pblock = WITH_LOCK (miner.cs, return miner.getCurrentBlock (
+                                  PowAlgo::SHA256D, script, target));
+  BOOST_CHECK (pblock->GetHash () != hash1);
+  BOOST_CHECK_EQUAL (pblock->vtx.size (), 2);
+  BOOST_CHECK_EQUAL (pblock->vtx[0]->vout[0].nValue, value1 + fee);
+
+  /* The better template was pushed to the listener as well.  */
+  waitForPushedWork (1);
+  {
+    LOCK (csWork);
+    BOOST_REQUIRE_EQUAL (pushedWork.size (), 1);
+    BOOST_CHECK_EQUAL (pushedWork[0]["hash"].get_str (),
+                       pblock->GetHash ().GetHex ());
+  }
+
+  /* A new tip gets the template prebuilt for the requested algo only, and
+     work for the previous payout script is pushed.  */
+  MineBlock (m_node, script);
+  SyncWithValidationInterfaceQueue ();
+  waitForPushedWork (2);
+  BOOST_CHECK (miner.hasBaseTemplate (PowAlgo::SHA256D));
+  BOOST_CHECK (!miner.hasBaseTemplate (PowAlgo::NEOSCRYPT));
+  {
+    LOCK2 (csWork, miner.cs);
+    BOOST_REQUIRE_EQUAL (pushedWork.size (), 2);
+    const UniValue& work = pushedWork[1];
+    BOOST_CHECK_EQUAL (work["algo"].get_str (), "sha256d");
+    BOOST_CHECK_EQUAL (work["previousblockhash"].get_str (),
+                       WITH_LOCK (cs_main, return m_node.chainman->ActiveTip ()
+                                                ->GetBlockHash ().GetHex ()));
+    const CBlock* pushed = miner.lookupSavedBlock (work["hash"].get_str ());
+    BOOST_CHECK (pushed->vtx[0]->vout[0].scriptPubKey == script);
+  }
+
+  miner.stopNotifications ();
+  SetMockTime (0);
+}
+
 /* ************************************************************************** */
 
 BOOST_AUTO_TEST_SUITE_END ()
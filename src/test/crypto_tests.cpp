@@ -8,6 +8,7 @@
 #include <crypto/hkdf_sha256_32.h>
 #include <crypto/hmac_sha256.h>
 #include <crypto/hmac_sha512.h>
+#include <crypto/neoscrypt.h>
 #include <crypto/poly1305.h>
 #include <crypto/ripemd160.h>
 #include <crypto/sha1.h>
@@ -753,6 +754,42 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(neoscrypt_multi_tests)
+{
+    // Run each kernel the CPU supports on its own against the scalar code,
+    // and then the automatic selection that combines them.  Kernels that are
+    // not compiled in fall back to the scalar code.
+    const unsigned int supported = cpu_vec_exts();
+    const std::vector<unsigned int> kernels = {
+        0,
+        NEOSCRYPT_VEC_SSE2,
+        NEOSCRYPT_VEC_AVX2,
+        NEOSCRYPT_VEC_SSE2 | NEOSCRYPT_VEC_AVX2,
+    };
+    for (const unsigned int exts : kernels) {
+        if ((exts & supported) != exts) {
+            BOOST_TEST_MESSAGE("Skipping neoscrypt kernels " << exts << ", not supported by the CPU");
+            continue;
+        }
+        // Cover full groups for the 8-way and 4-way kernels as well as the
+        // scalar remainder.
+        for (unsigned int i = 0; i <= 17; ++i) {
+            unsigned char in[80 * 17];
+            unsigned char out1[32 * 17], out2[32 * 17], out3[32 * 17];
+            for (unsigned int j = 0; j < 80 * i; ++j) {
+                in[j] = InsecureRandBits(8);
+            }
+            for (unsigned int j = 0; j < i; ++j) {
+                neoscrypt(in + 80 * j, out1 + 32 * j, 0);
+            }
+            neoscrypt_multi_exts(in, out2, 0, i, exts);
+            BOOST_CHECK_MESSAGE(memcmp(out1, out2, 32 * i) == 0, "kernels " << exts << ", count " << i);
+            neoscrypt_multi(in, out3, 0, i);
+            BOOST_CHECK(memcmp(out1, out3, 32 * i) == 0);
+        }
+    }
+}
+
 static void TestSHA3_256(const std::string& input, const std::string& output)
 {
     const auto in_bytes = ParseHex(input);
@@ -0,0 +1,623 @@
+namespace json_tests{
+static unsigned const char game_block_cbor[] = {
+0x5b, 0x0a, 0x20, 0x20, 0x5b, 0x22, 0x65, 0x6d, 
+0x70, 0x74, 0x79, 0x20, 0x62, 0x6c, 0x6f, 0x63, 
+0x6b, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x7b, 
+0x22, 0x62, 0x6c, 0x6f, 0x63, 0x6b, 0x22, 0x3a, 
+0x20, 0x7b, 0x22, 0x68, 0x61, 0x73, 0x68, 0x22, 
+0x3a, 0x20, 0x22, 0x32, 0x62, 0x31, 0x63, 0x36, 
+0x66, 0x31, 0x63, 0x30, 0x64, 0x35, 0x62, 0x64, 
+0x32, 0x61, 0x31, 0x65, 0x30, 0x64, 0x30, 0x64, 
+0x32, 0x61, 0x35, 0x66, 0x38, 0x66, 0x35, 0x63, 
+0x33, 0x66, 0x66, 0x62, 0x35, 0x63, 0x32, 0x61, 
+0x39, 0x65, 0x36, 0x63, 0x37, 0x64, 0x38, 0x65, 
+0x39, 0x66, 0x30, 0x61, 0x31, 0x62, 0x32, 0x63, 
+0x33, 0x64, 0x34, 0x65, 0x35, 0x66, 0x36, 0x30, 
+0x37, 0x31, 0x38, 0x22, 0x2c, 0x20, 0x22, 0x70, 
+0x61, 0x72, 0x65, 0x6e, 0x74, 0x22, 0x3a, 0x20, 
+0x22, 0x30, 0x66, 0x39, 0x31, 0x38, 0x38, 0x66, 
+0x31, 0x33, 0x63, 0x62, 0x37, 0x62, 0x32, 0x63, 
+0x37, 0x31, 0x66, 0x32, 0x61, 0x33, 0x33, 0x35, 
+0x65, 0x33, 0x61, 0x34, 0x66, 0x63, 0x33, 0x32, 
+0x38, 0x62, 0x66, 0x35, 0x62, 0x65, 0x62, 0x34, 
+0x33, 0x36, 0x30, 0x31, 0x32, 0x61, 0x66, 0x63, 
+0x61, 0x35, 0x39, 0x30, 0x62, 0x31, 0x61, 0x31, 
+0x31, 0x34, 0x36, 0x36, 0x65, 0x32, 0x32, 0x30, 
+0x36, 0x22, 0x2c, 0x20, 0x22, 0x74, 0x69, 0x6d, 
+0x65, 0x73, 0x74, 0x61, 0x6d, 0x70, 0x22, 0x3a, 
+0x20, 0x31, 0x36, 0x30, 0x30, 0x30, 0x30, 0x30, 
+0x30, 0x30, 0x30, 0x2c, 0x20, 0x22, 0x72, 0x6e, 
+0x67, 0x73, 0x65, 0x65, 0x64, 0x22, 0x3a, 0x20, 
+0x22, 0x36, 0x61, 0x31, 0x64, 0x35, 0x64, 0x31, 
+0x66, 0x33, 0x65, 0x30, 0x66, 0x34, 0x63, 0x31, 
+0x62, 0x32, 0x61, 0x33, 0x39, 0x34, 0x38, 0x35, 
+0x37, 0x36, 0x36, 0x37, 0x35, 0x38, 0x34, 0x39, 
+0x33, 0x61, 0x32, 0x62, 0x31, 0x63, 0x30, 0x64, 
+0x39, 0x65, 0x38, 0x66, 0x37, 0x30, 0x36, 0x31, 
+0x35, 0x32, 0x34, 0x33, 0x33, 0x34, 0x32, 0x35, 
+0x31, 0x36, 0x30, 0x37, 0x66, 0x38, 0x65, 0x39, 
+0x64, 0x22, 0x2c, 0x20, 0x22, 0x68, 0x65, 0x69, 
+0x67, 0x68, 0x74, 0x22, 0x3a, 0x20, 0x31, 0x32, 
+0x33, 0x34, 0x35, 0x36, 0x2c, 0x20, 0x22, 0x6d, 
+0x65, 0x64, 0x69, 0x61, 0x6e, 0x74, 0x69, 0x6d, 
+0x65, 0x22, 0x3a, 0x20, 0x31, 0x35, 0x39, 0x39, 
+0x39, 0x39, 0x39, 0x30, 0x30, 0x30, 0x7d, 0x2c, 
+0x20, 0x22, 0x6d, 0x6f, 0x76, 0x65, 0x73, 0x22, 
+0x3a, 0x20, 0x5b, 0x5d, 0x2c, 0x20, 0x22, 0x61, 
+0x64, 0x6d, 0x69, 0x6e, 0x22, 0x3a, 0x20, 0x5b, 
+0x5d, 0x7d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x22, 
+0x61, 0x33, 0x36, 0x35, 0x36, 0x32, 0x36, 0x63, 
+0x36, 0x66, 0x36, 0x33, 0x36, 0x62, 0x61, 0x36, 
+0x36, 0x34, 0x36, 0x38, 0x36, 0x31, 0x37, 0x33, 
+0x36, 0x38, 0x35, 0x38, 0x32, 0x30, 0x32, 0x62, 
+0x31, 0x63, 0x36, 0x66, 0x31, 0x63, 0x30, 0x64, 
+0x35, 0x62, 0x64, 0x32, 0x61, 0x31, 0x65, 0x30, 
+0x64, 0x30, 0x64, 0x32, 0x61, 0x35, 0x66, 0x38, 
+0x66, 0x35, 0x63, 0x33, 0x66, 0x66, 0x62, 0x35, 
+0x63, 0x32, 0x61, 0x39, 0x65, 0x36, 0x63, 0x37, 
+0x64, 0x38, 0x65, 0x39, 0x66, 0x30, 0x61, 0x31, 
+0x62, 0x32, 0x63, 0x33, 0x64, 0x34, 0x65, 0x35, 
+0x66, 0x36, 0x30, 0x37, 0x31, 0x38, 0x36, 0x36, 
+0x37, 0x30, 0x36, 0x31, 0x37, 0x32, 0x36, 0x35, 
+0x36, 0x65, 0x37, 0x34, 0x35, 0x38, 0x32, 0x30, 
+0x30, 0x66, 0x39, 0x31, 0x38, 0x38, 0x66, 0x31, 
+0x33, 0x63, 0x62, 0x37, 0x62, 0x32, 0x63, 0x37, 
+0x31, 0x66, 0x32, 0x61, 0x33, 0x33, 0x35, 0x65, 
+0x33, 0x61, 0x34, 0x66, 0x63, 0x33, 0x32, 0x38, 
+0x62, 0x66, 0x35, 0x62, 0x65, 0x62, 0x34, 0x33, 
+0x36, 0x30, 0x31, 0x32, 0x61, 0x66, 0x63, 0x61, 
+0x35, 0x39, 0x30, 0x62, 0x31, 0x61, 0x31, 0x31, 
+0x34, 0x36, 0x36, 0x65, 0x32, 0x32, 0x30, 0x36, 
+0x36, 0x39, 0x37, 0x34, 0x36, 0x39, 0x36, 0x64, 
+0x36, 0x35, 0x37, 0x33, 0x37, 0x34, 0x36, 0x31, 
+0x36, 0x64, 0x37, 0x30, 0x31, 0x61, 0x35, 0x66, 
+0x35, 0x65, 0x31, 0x30, 0x30, 0x30, 0x36, 0x37, 
+0x37, 0x32, 0x36, 0x65, 0x36, 0x37, 0x37, 0x33, 
+0x36, 0x35, 0x36, 0x35, 0x36, 0x34, 0x35, 0x38, 
+0x32, 0x30, 0x36, 0x61, 0x31, 0x64, 0x35, 0x64, 
+0x31, 0x66, 0x33, 0x65, 0x30, 0x66, 0x34, 0x63, 
+0x31, 0x62, 0x32, 0x61, 0x33, 0x39, 0x34, 0x38, 
+0x35, 0x37, 0x36, 0x36, 0x37, 0x35, 0x38, 0x34, 
+0x39, 0x33, 0x61, 0x32, 0x62, 0x31, 0x63, 0x30, 
+0x64, 0x39, 0x65, 0x38, 0x66, 0x37, 0x30, 0x36, 
+0x31, 0x35, 0x32, 0x34, 0x33, 0x33, 0x34, 0x32, 
+0x35, 0x31, 0x36, 0x30, 0x37, 0x66, 0x38, 0x65, 
+0x39, 0x64, 0x36, 0x36, 0x36, 0x38, 0x36, 0x35, 
+0x36, 0x39, 0x36, 0x37, 0x36, 0x38, 0x37, 0x34, 
+0x31, 0x61, 0x30, 0x30, 0x30, 0x31, 0x65, 0x32, 
+0x34, 0x30, 0x36, 0x61, 0x36, 0x64, 0x36, 0x35, 
+0x36, 0x34, 0x36, 0x39, 0x36, 0x31, 0x36, 0x65, 
+0x37, 0x34, 0x36, 0x39, 0x36, 0x64, 0x36, 0x35, 
+0x31, 0x61, 0x35, 0x66, 0x35, 0x65, 0x30, 0x63, 
+0x31, 0x38, 0x36, 0x35, 0x36, 0x64, 0x36, 0x66, 
+0x37, 0x36, 0x36, 0x35, 0x37, 0x33, 0x38, 0x30, 
+0x36, 0x35, 0x36, 0x31, 0x36, 0x34, 0x36, 0x64, 
+0x36, 0x39, 0x36, 0x65, 0x38, 0x30, 0x22, 0x5d, 
+0x2c, 0x0a, 0x20, 0x20, 0x5b, 0x22, 0x6d, 0x6f, 
+0x76, 0x65, 0x73, 0x20, 0x61, 0x6e, 0x64, 0x20, 
+0x61, 0x64, 0x6d, 0x69, 0x6e, 0x20, 0x63, 0x6f, 
+0x6d, 0x6d, 0x61, 0x6e, 0x64, 0x20, 0x77, 0x69, 
+0x74, 0x68, 0x20, 0x72, 0x65, 0x71, 0x75, 0x65, 
+0x73, 0x74, 0x20, 0x74, 0x6f, 0x6b, 0x65, 0x6e, 
+0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x7b, 0x22, 
+0x62, 0x6c, 0x6f, 0x63, 0x6b, 0x22, 0x3a, 0x20, 
+0x7b, 0x22, 0x68, 0x61, 0x73, 0x68, 0x22, 0x3a, 
+0x20, 0x22, 0x32, 0x62, 0x31, 0x63, 0x36, 0x66, 
+0x31, 0x63, 0x30, 0x64, 0x35, 0x62, 0x64, 0x32, 
+0x61, 0x31, 0x65, 0x30, 0x64, 0x30, 0x64, 0x32, 
+0x61, 0x35, 0x66, 0x38, 0x66, 0x35, 0x63, 0x33, 
+0x66, 0x66, 0x62, 0x35, 0x63, 0x32, 0x61, 0x39, 
+0x65, 0x36, 0x63, 0x37, 0x64, 0x38, 0x65, 0x39, 
+0x66, 0x30, 0x61, 0x31, 0x62, 0x32, 0x63, 0x33, 
+0x64, 0x34, 0x65, 0x35, 0x66, 0x36, 0x30, 0x37, 
+0x31, 0x38, 0x22, 0x2c, 0x20, 0x22, 0x70, 0x61, 
+0x72, 0x65, 0x6e, 0x74, 0x22, 0x3a, 0x20, 0x22, 
+0x30, 0x66, 0x39, 0x31, 0x38, 0x38, 0x66, 0x31, 
+0x33, 0x63, 0x62, 0x37, 0x62, 0x32, 0x63, 0x37, 
+0x31, 0x66, 0x32, 0x61, 0x33, 0x33, 0x35, 0x65, 
+0x33, 0x61, 0x34, 0x66, 0x63, 0x33, 0x32, 0x38, 
+0x62, 0x66, 0x35, 0x62, 0x65, 0x62, 0x34, 0x33, 
+0x36, 0x30, 0x31, 0x32, 0x61, 0x66, 0x63, 0x61, 
+0x35, 0x39, 0x30, 0x62, 0x31, 0x61, 0x31, 0x31, 
+0x34, 0x36, 0x36, 0x65, 0x32, 0x32, 0x30, 0x36, 
+0x22, 0x2c, 0x20, 0x22, 0x74, 0x69, 0x6d, 0x65, 
+0x73, 0x74, 0x61, 0x6d, 0x70, 0x22, 0x3a, 0x20, 
+0x31, 0x36, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 
+0x30, 0x30, 0x2c, 0x20, 0x22, 0x72, 0x6e, 0x67, 
+0x73, 0x65, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x22, 
+0x36, 0x61, 0x31, 0x64, 0x35, 0x64, 0x31, 0x66, 
+0x33, 0x65, 0x30, 0x66, 0x34, 0x63, 0x31, 0x62, 
+0x32, 0x61, 0x33, 0x39, 0x34, 0x38, 0x35, 0x37, 
+0x36, 0x36, 0x37, 0x35, 0x38, 0x34, 0x39, 0x33, 
+0x61, 0x32, 0x62, 0x31, 0x63, 0x30, 0x64, 0x39, 
+0x65, 0x38, 0x66, 0x37, 0x30, 0x36, 0x31, 0x35, 
+0x32, 0x34, 0x33, 0x33, 0x34, 0x32, 0x35, 0x31, 
+0x36, 0x30, 0x37, 0x66, 0x38, 0x65, 0x39, 0x64, 
+0x22, 0x2c, 0x20, 0x22, 0x68, 0x65, 0x69, 0x67, 
+0x68, 0x74, 0x22, 0x3a, 0x20, 0x31, 0x32, 0x33, 
+0x34, 0x35, 0x36, 0x2c, 0x20, 0x22, 0x6d, 0x65, 
+0x64, 0x69, 0x61, 0x6e, 0x74, 0x69, 0x6d, 0x65, 
+0x22, 0x3a, 0x20, 0x31, 0x35, 0x39, 0x39, 0x39, 
+0x39, 0x39, 0x30, 0x30, 0x30, 0x7d, 0x2c, 0x20, 
+0x22, 0x72, 0x65, 0x71, 0x74, 0x6f, 0x6b, 0x65, 
+0x6e, 0x22, 0x3a, 0x20, 0x22, 0x30, 0x31, 0x32, 
+0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x61, 
+0x62, 0x63, 0x64, 0x65, 0x66, 0x30, 0x31, 0x32, 
+0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x61, 
+0x62, 0x63, 0x64, 0x65, 0x66, 0x22, 0x2c, 0x20, 
+0x22, 0x6d, 0x6f, 0x76, 0x65, 0x73, 0x22, 0x3a, 
+0x20, 0x5b, 0x7b, 0x22, 0x74, 0x78, 0x69, 0x64, 
+0x22, 0x3a, 0x20, 0x22, 0x63, 0x35, 0x65, 0x30, 
+0x62, 0x33, 0x61, 0x37, 0x64, 0x34, 0x66, 0x31, 
+0x39, 0x32, 0x38, 0x33, 0x37, 0x34, 0x36, 0x35, 
+0x35, 0x36, 0x34, 0x37, 0x33, 0x38, 0x32, 0x39, 
+0x31, 0x30, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 
+0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 
+0x38, 0x39, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 
+0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 
+0x38, 0x39, 0x61, 0x62, 0x22, 0x2c, 0x20, 0x22, 
+0x62, 0x74, 0x78, 0x69, 0x64, 0x22, 0x3a, 0x20, 
+0x22, 0x64, 0x36, 0x66, 0x31, 0x63, 0x34, 0x62, 
+0x38, 0x65, 0x35, 0x61, 0x32, 0x30, 0x33, 0x39, 
+0x34, 0x38, 0x35, 0x37, 0x36, 0x36, 0x37, 0x35, 
+0x38, 0x34, 0x39, 0x33, 0x61, 0x32, 0x62, 0x31, 
+0x63, 0x64, 0x65, 0x66, 0x30, 0x31, 0x32, 0x33, 
+0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x61, 0x62, 
+0x63, 0x64, 0x65, 0x66, 0x30, 0x31, 0x32, 0x33, 
+0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x61, 0x62, 
+0x63, 0x22, 0x2c, 0x20, 0x22, 0x6e, 0x61, 0x6d, 
+0x65, 0x22, 0x3a, 0x20, 0x22, 0x64, 0x6f, 0x6d, 
+0x6f, 0x62, 0x22, 0x2c, 0x20, 0x22, 0x69, 0x6e, 
+0x70, 0x75, 0x74, 0x73, 0x22, 0x3a, 0x20, 0x5b, 
+0x7b, 0x22, 0x74, 0x78, 0x69, 0x64, 0x22, 0x3a, 
+0x20, 0x22, 0x30, 0x66, 0x39, 0x31, 0x38, 0x38, 
+0x66, 0x31, 0x33, 0x63, 0x62, 0x37, 0x62, 0x32, 
+0x63, 0x37, 0x31, 0x66, 0x32, 0x61, 0x33, 0x33, 
+0x35, 0x65, 0x33, 0x61, 0x34, 0x66, 0x63, 0x33, 
+0x32, 0x38, 0x62, 0x66, 0x35, 0x62, 0x65, 0x62, 
+0x34, 0x33, 0x36, 0x30, 0x31, 0x32, 0x61, 0x66, 
+0x63, 0x61, 0x35, 0x39, 0x30, 0x62, 0x31, 0x61, 
+0x31, 0x31, 0x34, 0x36, 0x36, 0x65, 0x32, 0x32, 
+0x30, 0x36, 0x22, 0x2c, 0x20, 0x22, 0x76, 0x6f, 
+0x75, 0x74, 0x22, 0x3a, 0x20, 0x30, 0x7d, 0x2c, 
+0x20, 0x7b, 0x22, 0x74, 0x78, 0x69, 0x64, 0x22, 
+0x3a, 0x20, 0x22, 0x36, 0x61, 0x31, 0x64, 0x35, 
+0x64, 0x31, 0x66, 0x33, 0x65, 0x30, 0x66, 0x34, 
+0x63, 0x31, 0x62, 0x32, 0x61, 0x33, 0x39, 0x34, 
+0x38, 0x35, 0x37, 0x36, 0x36, 0x37, 0x35, 0x38, 
+0x34, 0x39, 0x33, 0x61, 0x32, 0x62, 0x31, 0x63, 
+0x30, 0x64, 0x39, 0x65, 0x38, 0x66, 0x37, 0x30, 
+0x36, 0x31, 0x35, 0x32, 0x34, 0x33, 0x33, 0x34, 
+0x32, 0x35, 0x31, 0x36, 0x30, 0x37, 0x66, 0x38, 
+0x65, 0x39, 0x64, 0x22, 0x2c, 0x20, 0x22, 0x76, 
+0x6f, 0x75, 0x74, 0x22, 0x3a, 0x20, 0x33, 0x30, 
+0x30, 0x7d, 0x5d, 0x2c, 0x20, 0x22, 0x6f, 0x75, 
+0x74, 0x22, 0x3a, 0x20, 0x7b, 0x22, 0x63, 0x68, 
+0x69, 0x31, 0x71, 0x78, 0x79, 0x7a, 0x22, 0x3a, 
+0x20, 0x31, 0x2e, 0x35, 0x30, 0x30, 0x30, 0x30, 
+0x30, 0x30, 0x30, 0x2c, 0x20, 0x22, 0x63, 0x68, 
+0x69, 0x31, 0x71, 0x61, 0x62, 0x63, 0x22, 0x3a, 
+0x20, 0x30, 0x2e, 0x30, 0x30, 0x31, 0x30, 0x30, 
+0x30, 0x30, 0x30, 0x7d, 0x2c, 0x20, 0x22, 0x6d, 
+0x6f, 0x76, 0x65, 0x22, 0x3a, 0x20, 0x7b, 0x22, 
+0x6d, 0x22, 0x3a, 0x20, 0x5b, 0x31, 0x2c, 0x20, 
+0x2d, 0x32, 0x2c, 0x20, 0x33, 0x2e, 0x32, 0x35, 
+0x2c, 0x20, 0x31, 0x65, 0x33, 0x2c, 0x20, 0x31, 
+0x38, 0x34, 0x34, 0x36, 0x37, 0x34, 0x34, 0x30, 
+0x37, 0x33, 0x37, 0x30, 0x39, 0x35, 0x35, 0x31, 
+0x36, 0x31, 0x35, 0x2c, 0x20, 0x2d, 0x39, 0x32, 
+0x32, 0x33, 0x33, 0x37, 0x32, 0x30, 0x33, 0x36, 
+0x38, 0x35, 0x34, 0x37, 0x37, 0x35, 0x38, 0x30, 
+0x38, 0x2c, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x20, 
+0x6e, 0x75, 0x6c, 0x6c, 0x2c, 0x20, 0x22, 0x78, 
+0xc3, 0xa4, 0x22, 0x5d, 0x2c, 0x20, 0x22, 0x6e, 
+0x22, 0x3a, 0x20, 0x7b, 0x7d, 0x7d, 0x2c, 0x20, 
+0x22, 0x62, 0x75, 0x72, 0x6e, 0x74, 0x22, 0x3a, 
+0x20, 0x31, 0x32, 0x2e, 0x30, 0x30, 0x30, 0x30, 
+0x30, 0x30, 0x30, 0x30, 0x7d, 0x2c, 0x20, 0x7b, 
+0x22, 0x74, 0x78, 0x69, 0x64, 0x22, 0x3a, 0x20, 
+0x22, 0x65, 0x37, 0x61, 0x32, 0x64, 0x35, 0x63, 
+0x39, 0x66, 0x36, 0x62, 0x33, 0x31, 0x34, 0x61, 
+0x35, 0x39, 0x36, 0x38, 0x37, 0x37, 0x38, 0x36, 
+0x39, 0x35, 0x30, 0x34, 0x62, 0x33, 0x63, 0x32, 
+0x64, 0x65, 0x66, 0x30, 0x31, 0x32, 0x33, 0x34, 
+0x35, 0x36, 0x37, 0x38, 0x39, 0x61, 0x62, 0x63, 
+0x64, 0x65, 0x66, 0x30, 0x31, 0x32, 0x33, 0x34, 
+0x35, 0x36, 0x37, 0x38, 0x39, 0x61, 0x62, 0x63, 
+0x64, 0x22, 0x2c, 0x20, 0x22, 0x62, 0x74, 0x78, 
+0x69, 0x64, 0x22, 0x3a, 0x20, 0x22, 0x64, 0x36, 
+0x66, 0x31, 0x63, 0x34, 0x62, 0x38, 0x65, 0x35, 
+0x61, 0x32, 0x30, 0x33, 0x39, 0x34, 0x38, 0x35, 
+0x37, 0x36, 0x36, 0x37, 0x35, 0x38, 0x34, 0x39, 
+0x33, 0x61, 0x32, 0x62, 0x31, 0x63, 0x64, 0x65, 
+0x66, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 
+0x37, 0x38, 0x39, 0x61, 0x62, 0x63, 0x64, 0x65, 
+0x66, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 
+0x37, 0x38, 0x39, 0x61, 0x62, 0x63, 0x22, 0x2c, 
+0x20, 0x22, 0x6e, 0x61, 0x6d, 0x65, 0x22, 0x3a, 
+0x20, 0x22, 0x6f, 0x74, 0x68, 0x65, 0x72, 0x22, 
+0x2c, 0x20, 0x22, 0x69, 0x6e, 0x70, 0x75, 0x74, 
+0x73, 0x22, 0x3a, 0x20, 0x5b, 0x5d, 0x2c, 0x20, 
+0x22, 0x6f, 0x75, 0x74, 0x22, 0x3a, 0x20, 0x7b, 
+0x7d, 0x2c, 0x20, 0x22, 0x6d, 0x6f, 0x76, 0x65, 
+0x22, 0x3a, 0x20, 0x22, 0x73, 0x74, 0x72, 0x69, 
+0x6e, 0x67, 0x20, 0x6d, 0x6f, 0x76, 0x65, 0x22, 
+0x2c, 0x20, 0x22, 0x62, 0x75, 0x72, 0x6e, 0x74, 
+0x22, 0x3a, 0x20, 0x30, 0x7d, 0x5d, 0x2c, 0x20, 
+0x22, 0x61, 0x64, 0x6d, 0x69, 0x6e, 0x22, 0x3a, 
+0x20, 0x5b, 0x7b, 0x22, 0x74, 0x78, 0x69, 0x64, 
+0x22, 0x3a, 0x20, 0x22, 0x65, 0x37, 0x61, 0x32, 
+0x64, 0x35, 0x63, 0x39, 0x66, 0x36, 0x62, 0x33, 
+0x31, 0x34, 0x61, 0x35, 0x39, 0x36, 0x38, 0x37, 
+0x37, 0x38, 0x36, 0x39, 0x35, 0x30, 0x34, 0x62, 
+0x33, 0x63, 0x32, 0x64, 0x65, 0x66, 0x30, 0x31, 
+0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 
+0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x30, 0x31, 
+0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 
+0x61, 0x62, 0x63, 0x64, 0x22, 0x2c, 0x20, 0x22, 
+0x63, 0x6d, 0x64, 0x22, 0x3a, 0x20, 0x7b, 0x22, 
+0x72, 0x65, 0x73, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x34, 0x32, 0x7d, 0x7d, 0x5d, 0x7d, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x22, 0x61, 0x34, 0x36, 0x35, 
+0x36, 0x32, 0x36, 0x63, 0x36, 0x66, 0x36, 0x33, 
+0x36, 0x62, 0x61, 0x36, 0x36, 0x34, 0x36, 0x38, 
+0x36, 0x31, 0x37, 0x33, 0x36, 0x38, 0x35, 0x38, 
+0x32, 0x30, 0x32, 0x62, 0x31, 0x63, 0x36, 0x66, 
+0x31, 0x63, 0x30, 0x64, 0x35, 0x62, 0x64, 0x32, 
+0x61, 0x31, 0x65, 0x30, 0x64, 0x30, 0x64, 0x32, 
+0x61, 0x35, 0x66, 0x38, 0x66, 0x35, 0x63, 0x33, 
+0x66, 0x66, 0x62, 0x35, 0x63, 0x32, 0x61, 0x39, 
+0x65, 0x36, 0x63, 0x37, 0x64, 0x38, 0x65, 0x39, 
+0x66, 0x30, 0x61, 0x31, 0x62, 0x32, 0x63, 0x33, 
+0x64, 0x34, 0x65, 0x35, 0x66, 0x36, 0x30, 0x37, 
+0x31, 0x38, 0x36, 0x36, 0x37, 0x30, 0x36, 0x31, 
+0x37, 0x32, 0x36, 0x35, 0x36, 0x65, 0x37, 0x34, 
+0x35, 0x38, 0x32, 0x30, 0x30, 0x66, 0x39, 0x31, 
+0x38, 0x38, 0x66, 0x31, 0x33, 0x63, 0x62, 0x37, 
+0x62, 0x32, 0x63, 0x37, 0x31, 0x66, 0x32, 0x61, 
+0x33, 0x33, 0x35, 0x65, 0x33, 0x61, 0x34, 0x66, 
+0x63, 0x33, 0x32, 0x38, 0x62, 0x66, 0x35, 0x62, 
+0x65, 0x62, 0x34, 0x33, 0x36, 0x30, 0x31, 0x32, 
+0x61, 0x66, 0x63, 0x61, 0x35, 0x39, 0x30, 0x62, 
+0x31, 0x61, 0x31, 0x31, 0x34, 0x36, 0x36, 0x65, 
+0x32, 0x32, 0x30, 0x36, 0x36, 0x39, 0x37, 0x34, 
+0x36, 0x39, 0x36, 0x64, 0x36, 0x35, 0x37, 0x33, 
+0x37, 0x34, 0x36, 0x31, 0x36, 0x64, 0x37, 0x30, 
+0x31, 0x61, 0x35, 0x66, 0x35, 0x65, 0x31, 0x30, 
+0x30, 0x30, 0x36, 0x37, 0x37, 0x32, 0x36, 0x65, 
+0x36, 0x37, 0x37, 0x33, 0x36, 0x35, 0x36, 0x35, 
+0x36, 0x34, 0x35, 0x38, 0x32, 0x30, 0x36, 0x61, 
+0x31, 0x64, 0x35, 0x64, 0x31, 0x66, 0x33, 0x65, 
+0x30, 0x66, 0x34, 0x63, 0x31, 0x62, 0x32, 0x61, 
+0x33, 0x39, 0x34, 0x38, 0x35, 0x37, 0x36, 0x36, 
+0x37, 0x35, 0x38, 0x34, 0x39, 0x33, 0x61, 0x32, 
+0x62, 0x31, 0x63, 0x30, 0x64, 0x39, 0x65, 0x38, 
+0x66, 0x37, 0x30, 0x36, 0x31, 0x35, 0x32, 0x34, 
+0x33, 0x33, 0x34, 0x32, 0x35, 0x31, 0x36, 0x30, 
+0x37, 0x66, 0x38, 0x65, 0x39, 0x64, 0x36, 0x36, 
+0x36, 0x38, 0x36, 0x35, 0x36, 0x39, 0x36, 0x37, 
+0x36, 0x38, 0x37, 0x34, 0x31, 0x61, 0x30, 0x30, 
+0x30, 0x31, 0x65, 0x32, 0x34, 0x30, 0x36, 0x61, 
+0x36, 0x64, 0x36, 0x35, 0x36, 0x34, 0x36, 0x39, 
+0x36, 0x31, 0x36, 0x65, 0x37, 0x34, 0x36, 0x39, 
+0x36, 0x64, 0x36, 0x35, 0x31, 0x61, 0x35, 0x66, 
+0x35, 0x65, 0x30, 0x63, 0x31, 0x38, 0x36, 0x38, 
+0x37, 0x32, 0x36, 0x35, 0x37, 0x31, 0x37, 0x34, 
+0x36, 0x66, 0x36, 0x62, 0x36, 0x35, 0x36, 0x65, 
+0x37, 0x38, 0x32, 0x30, 0x33, 0x30, 0x33, 0x31, 
+0x33, 0x32, 0x33, 0x33, 0x33, 0x34, 0x33, 0x35, 
+0x33, 0x36, 0x33, 0x37, 0x33, 0x38, 0x33, 0x39, 
+0x36, 0x31, 0x36, 0x32, 0x36, 0x33, 0x36, 0x34, 
+0x36, 0x35, 0x36, 0x36, 0x33, 0x30, 0x33, 0x31, 
+0x33, 0x32, 0x33, 0x33, 0x33, 0x34, 0x33, 0x35, 
+0x33, 0x36, 0x33, 0x37, 0x33, 0x38, 0x33, 0x39, 
+0x36, 0x31, 0x36, 0x32, 0x36, 0x33, 0x36, 0x34, 
+0x36, 0x35, 0x36, 0x36, 0x36, 0x35, 0x36, 0x64, 
+0x36, 0x66, 0x37, 0x36, 0x36, 0x35, 0x37, 0x33, 
+0x38, 0x32, 0x61, 0x37, 0x36, 0x34, 0x37, 0x34, 
+0x37, 0x38, 0x36, 0x39, 0x36, 0x34, 0x35, 0x38, 
+0x32, 0x30, 0x63, 0x35, 0x65, 0x30, 0x62, 0x33, 
+0x61, 0x37, 0x64, 0x34, 0x66, 0x31, 0x39, 0x32, 
+0x38, 0x33, 0x37, 0x34, 0x36, 0x35, 0x35, 0x36, 
+0x34, 0x37, 0x33, 0x38, 0x32, 0x39, 0x31, 0x30, 
+0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x30, 0x31, 
+0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 
+0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x30, 0x31, 
+0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 
+0x61, 0x62, 0x36, 0x35, 0x36, 0x32, 0x37, 0x34, 
+0x37, 0x38, 0x36, 0x39, 0x36, 0x34, 0x35, 0x38, 
+0x32, 0x30, 0x64, 0x36, 0x66, 0x31, 0x63, 0x34, 
+0x62, 0x38, 0x65, 0x35, 0x61, 0x32, 0x30, 0x33, 
+0x39, 0x34, 0x38, 0x35, 0x37, 0x36, 0x36, 0x37, 
+0x35, 0x38, 0x34, 0x39, 0x33, 0x61, 0x32, 0x62, 
+0x31, 0x63, 0x64, 0x65, 0x66, 0x30, 0x31, 0x32, 
+0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x61, 
+0x62, 0x63, 0x64, 0x65, 0x66, 0x30, 0x31, 0x32, 
+0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x61, 
+0x62, 0x63, 0x36, 0x34, 0x36, 0x65, 0x36, 0x31, 
+0x36, 0x64, 0x36, 0x35, 0x36, 0x35, 0x36, 0x34, 
+0x36, 0x66, 0x36, 0x64, 0x36, 0x66, 0x36, 0x32, 
+0x36, 0x36, 0x36, 0x39, 0x36, 0x65, 0x37, 0x30, 
+0x37, 0x35, 0x37, 0x34, 0x37, 0x33, 0x38, 0x32, 
+0x61, 0x32, 0x36, 0x34, 0x37, 0x34, 0x37, 0x38, 
+0x36, 0x39, 0x36, 0x34, 0x35, 0x38, 0x32, 0x30, 
+0x30, 0x66, 0x39, 0x31, 0x38, 0x38, 0x66, 0x31, 
+0x33, 0x63, 0x62, 0x37, 0x62, 0x32, 0x63, 0x37, 
+0x31, 0x66, 0x32, 0x61, 0x33, 0x33, 0x35, 0x65, 
+0x33, 0x61, 0x34, 0x66, 0x63, 0x33, 0x32, 0x38, 
+0x62, 0x66, 0x35, 0x62, 0x65, 0x62, 0x34, 0x33, 
+0x36, 0x30, 0x31, 0x32, 0x61, 0x66, 0x63, 0x61, 
+0x35, 0x39, 0x30, 0x62, 0x31, 0x61, 0x31, 0x31, 
+0x34, 0x36, 0x36, 0x65, 0x32, 0x32, 0x30, 0x36, 
+0x36, 0x34, 0x37, 0x36, 0x36, 0x66, 0x37, 0x35, 
+0x37, 0x34, 0x30, 0x30, 0x61, 0x32, 0x36, 0x34, 
+0x37, 0x34, 0x37, 0x38, 0x36, 0x39, 0x36, 0x34, 
+0x35, 0x38, 0x32, 0x30, 0x36, 0x61, 0x31, 0x64, 
+0x35, 0x64, 0x31, 0x66, 0x33, 0x65, 0x30, 0x66, 
+0x34, 0x63, 0x31, 0x62, 0x32, 0x61, 0x33, 0x39, 
+0x34, 0x38, 0x35, 0x37, 0x36, 0x36, 0x37, 0x35, 
+0x38, 0x34, 0x39, 0x33, 0x61, 0x32, 0x62, 0x31, 
+0x63, 0x30, 0x64, 0x39, 0x65, 0x38, 0x66, 0x37, 
+0x30, 0x36, 0x31, 0x35, 0x32, 0x34, 0x33, 0x33, 
+0x34, 0x32, 0x35, 0x31, 0x36, 0x30, 0x37, 0x66, 
+0x38, 0x65, 0x39, 0x64, 0x36, 0x34, 0x37, 0x36, 
+0x36, 0x66, 0x37, 0x35, 0x37, 0x34, 0x31, 0x39, 
+0x30, 0x31, 0x32, 0x63, 0x36, 0x33, 0x36, 0x66, 
+0x37, 0x35, 0x37, 0x34, 0x61, 0x32, 0x36, 0x38, 
+0x36, 0x33, 0x36, 0x38, 0x36, 0x39, 0x33, 0x31, 
+0x37, 0x31, 0x37, 0x38, 0x37, 0x39, 0x37, 0x61, 
+0x31, 0x61, 0x30, 0x38, 0x66, 0x30, 0x64, 0x31, 
+0x38, 0x30, 0x36, 0x38, 0x36, 0x33, 0x36, 0x38, 
+0x36, 0x39, 0x33, 0x31, 0x37, 0x31, 0x36, 0x31, 
+0x36, 0x32, 0x36, 0x33, 0x31, 0x61, 0x30, 0x30, 
+0x30, 0x31, 0x38, 0x36, 0x61, 0x30, 0x36, 0x34, 
+0x36, 0x64, 0x36, 0x66, 0x37, 0x36, 0x36, 0x35, 
+0x61, 0x32, 0x36, 0x31, 0x36, 0x64, 0x38, 0x61, 
+0x30, 0x31, 0x32, 0x31, 0x66, 0x62, 0x34, 0x30, 
+0x30, 0x61, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 
+0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x66, 0x62, 
+0x34, 0x30, 0x38, 0x66, 0x34, 0x30, 0x30, 0x30, 
+0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 
+0x31, 0x62, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 
+0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 
+0x66, 0x66, 0x33, 0x62, 0x37, 0x66, 0x66, 0x66, 
+0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 
+0x66, 0x66, 0x66, 0x66, 0x66, 0x35, 0x66, 0x34, 
+0x66, 0x36, 0x36, 0x33, 0x37, 0x38, 0x63, 0x33, 
+0x61, 0x34, 0x36, 0x31, 0x36, 0x65, 0x61, 0x30, 
+0x36, 0x35, 0x36, 0x32, 0x37, 0x35, 0x37, 0x32, 
+0x36, 0x65, 0x37, 0x34, 0x31, 0x61, 0x34, 0x37, 
+0x38, 0x36, 0x38, 0x63, 0x30, 0x30, 0x61, 0x37, 
+0x36, 0x34, 0x37, 0x34, 0x37, 0x38, 0x36, 0x39, 
+0x36, 0x34, 0x35, 0x38, 0x32, 0x30, 0x65, 0x37, 
+0x61, 0x32, 0x64, 0x35, 0x63, 0x39, 0x66, 0x36, 
+0x62, 0x33, 0x31, 0x34, 0x61, 0x35, 0x39, 0x36, 
+0x38, 0x37, 0x37, 0x38, 0x36, 0x39, 0x35, 0x30, 
+0x34, 0x62, 0x33, 0x63, 0x32, 0x64, 0x65, 0x66, 
+0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 
+0x38, 0x39, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 
+0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 
+0x38, 0x39, 0x61, 0x62, 0x63, 0x64, 0x36, 0x35, 
+0x36, 0x32, 0x37, 0x34, 0x37, 0x38, 0x36, 0x39, 
+0x36, 0x34, 0x35, 0x38, 0x32, 0x30, 0x64, 0x36, 
+0x66, 0x31, 0x63, 0x34, 0x62, 0x38, 0x65, 0x35, 
+0x61, 0x32, 0x30, 0x33, 0x39, 0x34, 0x38, 0x35, 
+0x37, 0x36, 0x36, 0x37, 0x35, 0x38, 0x34, 0x39, 
+0x33, 0x61, 0x32, 0x62, 0x31, 0x63, 0x64, 0x65, 
+0x66, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 
+0x37, 0x38, 0x39, 0x61, 0x62, 0x63, 0x64, 0x65, 
+0x66, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 
+0x37, 0x38, 0x39, 0x61, 0x62, 0x63, 0x36, 0x34, 
+0x36, 0x65, 0x36, 0x31, 0x36, 0x64, 0x36, 0x35, 
+0x36, 0x35, 0x36, 0x66, 0x37, 0x34, 0x36, 0x38, 
+0x36, 0x35, 0x37, 0x32, 0x36, 0x36, 0x36, 0x39, 
+0x36, 0x65, 0x37, 0x30, 0x37, 0x35, 0x37, 0x34, 
+0x37, 0x33, 0x38, 0x30, 0x36, 0x33, 0x36, 0x66, 
+0x37, 0x35, 0x37, 0x34, 0x61, 0x30, 0x36, 0x34, 
+0x36, 0x64, 0x36, 0x66, 0x37, 0x36, 0x36, 0x35, 
+0x36, 0x62, 0x37, 0x33, 0x37, 0x34, 0x37, 0x32, 
+0x36, 0x39, 0x36, 0x65, 0x36, 0x37, 0x32, 0x30, 
+0x36, 0x64, 0x36, 0x66, 0x37, 0x36, 0x36, 0x35, 
+0x36, 0x35, 0x36, 0x32, 0x37, 0x35, 0x37, 0x32, 
+0x36, 0x65, 0x37, 0x34, 0x30, 0x30, 0x36, 0x35, 
+0x36, 0x31, 0x36, 0x34, 0x36, 0x64, 0x36, 0x39, 
+0x36, 0x65, 0x38, 0x31, 0x61, 0x32, 0x36, 0x34, 
+0x37, 0x34, 0x37, 0x38, 0x36, 0x39, 0x36, 0x34, 
+0x35, 0x38, 0x32, 0x30, 0x65, 0x37, 0x61, 0x32, 
+0x64, 0x35, 0x63, 0x39, 0x66, 0x36, 0x62, 0x33, 
+0x31, 0x34, 0x61, 0x35, 0x39, 0x36, 0x38, 0x37, 
+0x37, 0x38, 0x36, 0x39, 0x35, 0x30, 0x34, 0x62, 
+0x33, 0x63, 0x32, 0x64, 0x65, 0x66, 0x30, 0x31, 
+0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 
+0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x30, 0x31, 
+0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 
+0x61, 0x62, 0x63, 0x64, 0x36, 0x33, 0x36, 0x33, 
+0x36, 0x64, 0x36, 0x34, 0x61, 0x31, 0x36, 0x35, 
+0x37, 0x32, 0x36, 0x35, 0x37, 0x33, 0x36, 0x35, 
+0x37, 0x34, 0x31, 0x38, 0x32, 0x61, 0x22, 0x5d, 
+0x2c, 0x0a, 0x20, 0x20, 0x5b, 0x22, 0x67, 0x65, 
+0x6e, 0x65, 0x73, 0x69, 0x73, 0x20, 0x62, 0x6c, 
+0x6f, 0x63, 0x6b, 0x20, 0x77, 0x69, 0x74, 0x68, 
+0x6f, 0x75, 0x74, 0x20, 0x70, 0x61, 0x72, 0x65, 
+0x6e, 0x74, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x7b, 0x22, 0x62, 0x6c, 0x6f, 0x63, 0x6b, 0x22, 
+0x3a, 0x20, 0x7b, 0x22, 0x68, 0x61, 0x73, 0x68, 
+0x22, 0x3a, 0x20, 0x22, 0x32, 0x62, 0x31, 0x63, 
+0x36, 0x66, 0x31, 0x63, 0x30, 0x64, 0x35, 0x62, 
+0x64, 0x32, 0x61, 0x31, 0x65, 0x30, 0x64, 0x30, 
+0x64, 0x32, 0x61, 0x35, 0x66, 0x38, 0x66, 0x35, 
+0x63, 0x33, 0x66, 0x66, 0x62, 0x35, 0x63, 0x32, 
+0x61, 0x39, 0x65, 0x36, 0x63, 0x37, 0x64, 0x38, 
+0x65, 0x39, 0x66, 0x30, 0x61, 0x31, 0x62, 0x32, 
+0x63, 0x33, 0x64, 0x34, 0x65, 0x35, 0x66, 0x36, 
+0x30, 0x37, 0x31, 0x38, 0x22, 0x2c, 0x20, 0x22, 
+0x74, 0x69, 0x6d, 0x65, 0x73, 0x74, 0x61, 0x6d, 
+0x70, 0x22, 0x3a, 0x20, 0x30, 0x2c, 0x20, 0x22, 
+0x72, 0x6e, 0x67, 0x73, 0x65, 0x65, 0x64, 0x22, 
+0x3a, 0x20, 0x22, 0x36, 0x61, 0x31, 0x64, 0x35, 
+0x64, 0x31, 0x66, 0x33, 0x65, 0x30, 0x66, 0x34, 
+0x63, 0x31, 0x62, 0x32, 0x61, 0x33, 0x39, 0x34, 
+0x38, 0x35, 0x37, 0x36, 0x36, 0x37, 0x35, 0x38, 
+0x34, 0x39, 0x33, 0x61, 0x32, 0x62, 0x31, 0x63, 
+0x30, 0x64, 0x39, 0x65, 0x38, 0x66, 0x37, 0x30, 
+0x36, 0x31, 0x35, 0x32, 0x34, 0x33, 0x33, 0x34, 
+0x32, 0x35, 0x31, 0x36, 0x30, 0x37, 0x66, 0x38, 
+0x65, 0x39, 0x64, 0x22, 0x2c, 0x20, 0x22, 0x68, 
+0x65, 0x69, 0x67, 0x68, 0x74, 0x22, 0x3a, 0x20, 
+0x30, 0x2c, 0x20, 0x22, 0x6d, 0x65, 0x64, 0x69, 
+0x61, 0x6e, 0x74, 0x69, 0x6d, 0x65, 0x22, 0x3a, 
+0x20, 0x30, 0x7d, 0x2c, 0x20, 0x22, 0x6d, 0x6f, 
+0x76, 0x65, 0x73, 0x22, 0x3a, 0x20, 0x5b, 0x5d, 
+0x2c, 0x20, 0x22, 0x61, 0x64, 0x6d, 0x69, 0x6e, 
+0x22, 0x3a, 0x20, 0x5b, 0x5d, 0x7d, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x22, 0x61, 0x33, 0x36, 0x35, 
+0x36, 0x32, 0x36, 0x63, 0x36, 0x66, 0x36, 0x33, 
+0x36, 0x62, 0x61, 0x35, 0x36, 0x34, 0x36, 0x38, 
+0x36, 0x31, 0x37, 0x33, 0x36, 0x38, 0x35, 0x38, 
+0x32, 0x30, 0x32, 0x62, 0x31, 0x63, 0x36, 0x66, 
+0x31, 0x63, 0x30, 0x64, 0x35, 0x62, 0x64, 0x32, 
+0x61, 0x31, 0x65, 0x30, 0x64, 0x30, 0x64, 0x32, 
+0x61, 0x35, 0x66, 0x38, 0x66, 0x35, 0x63, 0x33, 
+0x66, 0x66, 0x62, 0x35, 0x63, 0x32, 0x61, 0x39, 
+0x65, 0x36, 0x63, 0x37, 0x64, 0x38, 0x65, 0x39, 
+0x66, 0x30, 0x61, 0x31, 0x62, 0x32, 0x63, 0x33, 
+0x64, 0x34, 0x65, 0x35, 0x66, 0x36, 0x30, 0x37, 
+0x31, 0x38, 0x36, 0x39, 0x37, 0x34, 0x36, 0x39, 
+0x36, 0x64, 0x36, 0x35, 0x37, 0x33, 0x37, 0x34, 
+0x36, 0x31, 0x36, 0x64, 0x37, 0x30, 0x30, 0x30, 
+0x36, 0x37, 0x37, 0x32, 0x36, 0x65, 0x36, 0x37, 
+0x37, 0x33, 0x36, 0x35, 0x36, 0x35, 0x36, 0x34, 
+0x35, 0x38, 0x32, 0x30, 0x36, 0x61, 0x31, 0x64, 
+0x35, 0x64, 0x31, 0x66, 0x33, 0x65, 0x30, 0x66, 
+0x34, 0x63, 0x31, 0x62, 0x32, 0x61, 0x33, 0x39, 
+0x34, 0x38, 0x35, 0x37, 0x36, 0x36, 0x37, 0x35, 
+0x38, 0x34, 0x39, 0x33, 0x61, 0x32, 0x62, 0x31, 
+0x63, 0x30, 0x64, 0x39, 0x65, 0x38, 0x66, 0x37, 
+0x30, 0x36, 0x31, 0x35, 0x32, 0x34, 0x33, 0x33, 
+0x34, 0x32, 0x35, 0x31, 0x36, 0x30, 0x37, 0x66, 
+0x38, 0x65, 0x39, 0x64, 0x36, 0x36, 0x36, 0x38, 
+0x36, 0x35, 0x36, 0x39, 0x36, 0x37, 0x36, 0x38, 
+0x37, 0x34, 0x30, 0x30, 0x36, 0x61, 0x36, 0x64, 
+0x36, 0x35, 0x36, 0x34, 0x36, 0x39, 0x36, 0x31, 
+0x36, 0x65, 0x37, 0x34, 0x36, 0x39, 0x36, 0x64, 
+0x36, 0x35, 0x30, 0x30, 0x36, 0x35, 0x36, 0x64, 
+0x36, 0x66, 0x37, 0x36, 0x36, 0x35, 0x37, 0x33, 
+0x38, 0x30, 0x36, 0x35, 0x36, 0x31, 0x36, 0x34, 
+0x36, 0x64, 0x36, 0x39, 0x36, 0x65, 0x38, 0x30, 
+0x22, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x5b, 0x22, 
+0x6e, 0x75, 0x6d, 0x62, 0x65, 0x72, 0x73, 0x20, 
+0x6f, 0x75, 0x74, 0x20, 0x6f, 0x66, 0x20, 0x72, 
+0x61, 0x6e, 0x67, 0x65, 0x20, 0x66, 0x6f, 0x72, 
+0x20, 0x64, 0x6f, 0x75, 0x62, 0x6c, 0x65, 0x73, 
+0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x7b, 0x22, 
+0x62, 0x6c, 0x6f, 0x63, 0x6b, 0x22, 0x3a, 0x20, 
+0x7b, 0x22, 0x68, 0x61, 0x73, 0x68, 0x22, 0x3a, 
+0x20, 0x22, 0x32, 0x62, 0x31, 0x63, 0x36, 0x66, 
+0x31, 0x63, 0x30, 0x64, 0x35, 0x62, 0x64, 0x32, 
+0x61, 0x31, 0x65, 0x30, 0x64, 0x30, 0x64, 0x32, 
+0x61, 0x35, 0x66, 0x38, 0x66, 0x35, 0x63, 0x33, 
+0x66, 0x66, 0x62, 0x35, 0x63, 0x32, 0x61, 0x39, 
+0x65, 0x36, 0x63, 0x37, 0x64, 0x38, 0x65, 0x39, 
+0x66, 0x30, 0x61, 0x31, 0x62, 0x32, 0x63, 0x33, 
+0x64, 0x34, 0x65, 0x35, 0x66, 0x36, 0x30, 0x37, 
+0x31, 0x38, 0x22, 0x2c, 0x20, 0x22, 0x74, 0x69, 
+0x6d, 0x65, 0x73, 0x74, 0x61, 0x6d, 0x70, 0x22, 
+0x3a, 0x20, 0x30, 0x2c, 0x20, 0x22, 0x72, 0x6e, 
+0x67, 0x73, 0x65, 0x65, 0x64, 0x22, 0x3a, 0x20, 
+0x22, 0x36, 0x61, 0x31, 0x64, 0x35, 0x64, 0x31, 
+0x66, 0x33, 0x65, 0x30, 0x66, 0x34, 0x63, 0x31, 
+0x62, 0x32, 0x61, 0x33, 0x39, 0x34, 0x38, 0x35, 
+0x37, 0x36, 0x36, 0x37, 0x35, 0x38, 0x34, 0x39, 
+0x33, 0x61, 0x32, 0x62, 0x31, 0x63, 0x30, 0x64, 
+0x39, 0x65, 0x38, 0x66, 0x37, 0x30, 0x36, 0x31, 
+0x35, 0x32, 0x34, 0x33, 0x33, 0x34, 0x32, 0x35, 
+0x31, 0x36, 0x30, 0x37, 0x66, 0x38, 0x65, 0x39, 
+0x64, 0x22, 0x2c, 0x20, 0x22, 0x68, 0x65, 0x69, 
+0x67, 0x68, 0x74, 0x22, 0x3a, 0x20, 0x30, 0x2c, 
+0x20, 0x22, 0x6d, 0x65, 0x64, 0x69, 0x61, 0x6e, 
+0x74, 0x69, 0x6d, 0x65, 0x22, 0x3a, 0x20, 0x30, 
+0x7d, 0x2c, 0x20, 0x22, 0x6d, 0x6f, 0x76, 0x65, 
+0x73, 0x22, 0x3a, 0x20, 0x5b, 0x5d, 0x2c, 0x20, 
+0x22, 0x61, 0x64, 0x6d, 0x69, 0x6e, 0x22, 0x3a, 
+0x20, 0x5b, 0x7b, 0x22, 0x74, 0x78, 0x69, 0x64, 
+0x22, 0x3a, 0x20, 0x22, 0x65, 0x37, 0x61, 0x32, 
+0x64, 0x35, 0x63, 0x39, 0x66, 0x36, 0x62, 0x33, 
+0x31, 0x34, 0x61, 0x35, 0x39, 0x36, 0x38, 0x37, 
+0x37, 0x38, 0x36, 0x39, 0x35, 0x30, 0x34, 0x62, 
+0x33, 0x63, 0x32, 0x64, 0x65, 0x66, 0x30, 0x31, 
+0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 
+0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x30, 0x31, 
+0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 
+0x61, 0x62, 0x63, 0x64, 0x22, 0x2c, 0x20, 0x22, 
+0x63, 0x6d, 0x64, 0x22, 0x3a, 0x20, 0x5b, 0x31, 
+0x65, 0x34, 0x30, 0x30, 0x2c, 0x20, 0x2d, 0x31, 
+0x65, 0x34, 0x30, 0x30, 0x2c, 0x20, 0x31, 0x38, 
+0x34, 0x34, 0x36, 0x37, 0x34, 0x34, 0x30, 0x37, 
+0x33, 0x37, 0x30, 0x39, 0x35, 0x35, 0x31, 0x36, 
+0x31, 0x36, 0x2c, 0x20, 0x31, 0x2e, 0x35, 0x65, 
+0x2d, 0x34, 0x30, 0x30, 0x2c, 0x20, 0x2d, 0x31, 
+0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 
+0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 
+0x38, 0x39, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 
+0x36, 0x37, 0x38, 0x39, 0x30, 0x65, 0x34, 0x30, 
+0x30, 0x5d, 0x7d, 0x5d, 0x7d, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x22, 0x61, 0x33, 0x36, 0x35, 0x36, 
+0x32, 0x36, 0x63, 0x36, 0x66, 0x36, 0x33, 0x36, 
+0x62, 0x61, 0x35, 0x36, 0x34, 0x36, 0x38, 0x36, 
+0x31, 0x37, 0x33, 0x36, 0x38, 0x35, 0x38, 0x32, 
+0x30, 0x32, 0x62, 0x31, 0x63, 0x36, 0x66, 0x31, 
+0x63, 0x30, 0x64, 0x35, 0x62, 0x64, 0x32, 0x61, 
+0x31, 0x65, 0x30, 0x64, 0x30, 0x64, 0x32, 0x61, 
+0x35, 0x66, 0x38, 0x66, 0x35, 0x63, 0x33, 0x66, 
+0x66, 0x62, 0x35, 0x63, 0x32, 0x61, 0x39, 0x65, 
+0x36, 0x63, 0x37, 0x64, 0x38, 0x65, 0x39, 0x66, 
+0x30, 0x61, 0x31, 0x62, 0x32, 0x63, 0x33, 0x64, 
+0x34, 0x65, 0x35, 0x66, 0x36, 0x30, 0x37, 0x31, 
+0x38, 0x36, 0x39, 0x37, 0x34, 0x36, 0x39, 0x36, 
+0x64, 0x36, 0x35, 0x37, 0x33, 0x37, 0x34, 0x36, 
+0x31, 0x36, 0x64, 0x37, 0x30, 0x30, 0x30, 0x36, 
+0x37, 0x37, 0x32, 0x36, 0x65, 0x36, 0x37, 0x37, 
+0x33, 0x36, 0x35, 0x36, 0x35, 0x36, 0x34, 0x35, 
+0x38, 0x32, 0x30, 0x36, 0x61, 0x31, 0x64, 0x35, 
+0x64, 0x31, 0x66, 0x33, 0x65, 0x30, 0x66, 0x34, 
+0x63, 0x31, 0x62, 0x32, 0x61, 0x33, 0x39, 0x34, 
+0x38, 0x35, 0x37, 0x36, 0x36, 0x37, 0x35, 0x38, 
+0x34, 0x39, 0x33, 0x61, 0x32, 0x62, 0x31, 0x63, 
+0x30, 0x64, 0x39, 0x65, 0x38, 0x66, 0x37, 0x30, 
+0x36, 0x31, 0x35, 0x32, 0x34, 0x33, 0x33, 0x34, 
+0x32, 0x35, 0x31, 0x36, 0x30, 0x37, 0x66, 0x38, 
+0x65, 0x39, 0x64, 0x36, 0x36, 0x36, 0x38, 0x36, 
+0x35, 0x36, 0x39, 0x36, 0x37, 0x36, 0x38, 0x37, 
+0x34, 0x30, 0x30, 0x36, 0x61, 0x36, 0x64, 0x36, 
+0x35, 0x36, 0x34, 0x36, 0x39, 0x36, 0x31, 0x36, 
+0x65, 0x37, 0x34, 0x36, 0x39, 0x36, 0x64, 0x36, 
+0x35, 0x30, 0x30, 0x36, 0x35, 0x36, 0x64, 0x36, 
+0x66, 0x37, 0x36, 0x36, 0x35, 0x37, 0x33, 0x38, 
+0x30, 0x36, 0x35, 0x36, 0x31, 0x36, 0x34, 0x36, 
+0x64, 0x36, 0x39, 0x36, 0x65, 0x38, 0x31, 0x61, 
+0x32, 0x36, 0x34, 0x37, 0x34, 0x37, 0x38, 0x36, 
+0x39, 0x36, 0x34, 0x35, 0x38, 0x32, 0x30, 0x65, 
+0x37, 0x61, 0x32, 0x64, 0x35, 0x63, 0x39, 0x66, 
+0x36, 0x62, 0x33, 0x31, 0x34, 0x61, 0x35, 0x39, 
+0x36, 0x38, 0x37, 0x37, 0x38, 0x36, 0x39, 0x35, 
+0x30, 0x34, 0x62, 0x33, 0x63, 0x32, 0x64, 0x65, 
+0x66, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 
+0x37, 0x38, 0x39, 0x61, 0x62, 0x63, 0x64, 0x65, 
+0x66, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 
+0x37, 0x38, 0x39, 0x61, 0x62, 0x63, 0x64, 0x36, 
+0x33, 0x36, 0x33, 0x36, 0x64, 0x36, 0x34, 0x38, 
+0x35, 0x63, 0x34, 0x38, 0x32, 0x31, 0x39, 0x30, 
+0x31, 0x39, 0x30, 0x30, 0x31, 0x63, 0x34, 0x38, 
+0x32, 0x31, 0x39, 0x30, 0x31, 0x39, 0x30, 0x32, 
+0x30, 0x66, 0x62, 0x34, 0x33, 0x66, 0x30, 0x30, 
+0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 
+0x30, 0x30, 0x30, 0x63, 0x34, 0x38, 0x32, 0x33, 
+0x39, 0x30, 0x31, 0x39, 0x30, 0x30, 0x66, 0x63, 
+0x34, 0x38, 0x32, 0x31, 0x39, 0x30, 0x31, 0x39, 
+0x30, 0x63, 0x33, 0x34, 0x64, 0x30, 0x31, 0x38, 
+0x65, 0x65, 0x39, 0x30, 0x66, 0x66, 0x36, 0x63, 
+0x33, 0x37, 0x33, 0x65, 0x30, 0x65, 0x65, 0x34, 
+0x65, 0x33, 0x66, 0x30, 0x61, 0x64, 0x31, 0x22, 
+0x5d, 0x0a, 0x5d, 0x0a,     
+};};
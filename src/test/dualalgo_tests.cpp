@@ -109,6 +109,7 @@ public:
     std::unique_ptr<CBlockIndex> modified(new CBlockIndex (indexNew));
     modified->pprev = tip ();
     modified->nHeight = blocks.size ();
+    modified->BuildSkip ();
     blocks.push_back (std::move (modified));
   }
 